@@ -0,0 +1,153 @@
+#include "ClockTimeline.h"
+
+ClockTimeline::ClockTimeline(LEDAbstraction *p)
+{
+  panel = p;
+  speedPercent = TIMELINE_NORMAL_SPEED;
+  isPaused = false;
+  clear();
+}
+
+static_assert(DISPLAY_PIXELS <= 256 || sizeof(timelineCell) == 2,
+	      "timelineCell is too small for the display");
+static_assert(TIMELINE_FRAME_CELLS < 16, "cell counts are kept in a nybble");
+
+void ClockTimeline::clear()
+{
+  frameCount = 0;
+  totalMillis = 0;
+  full = false;
+  playhead = 0;
+}
+
+bool ClockTimeline::addFrame(const timelineFrame &f)
+{
+  if (frameCount >= TIMELINE_MAX_FRAMES) {
+    full = true;
+    return false;
+  }
+  timeline[frameCount++] = f;
+  totalMillis += f.delay * TIMELINE_TICK_MILLIS;
+  return true;
+}
+
+bool ClockTimeline::addFrame(const timelineCell *cleared, uint8_t clearedCount,
+			     const timelineCell *set, uint8_t setCount,
+			     uint8_t colorIndex, uint16_t delayMillis)
+{
+  timelineFrame f;
+  memcpy(f.cleared, cleared, clearedCount * sizeof(timelineCell));
+  memcpy(f.set, set, setCount * sizeof(timelineCell));
+  f.counts = clearedCount | (setCount << 4);
+  f.colorIndex = colorIndex;
+  f.delay = delayMillis / TIMELINE_TICK_MILLIS;
+  return addFrame(f);
+}
+
+bool ClockTimeline::overflowed()
+{
+  return full;
+}
+
+uint16_t ClockTimeline::frames()
+{
+  return frameCount;
+}
+
+uint32_t ClockTimeline::duration()
+{
+  return totalMillis;
+}
+
+bool ClockTimeline::step()
+{
+  if (playhead >= frameCount)
+    return false;
+  if (!isPaused) {
+    apply(timeline[playhead++]);
+  }
+  return true;
+}
+
+uint32_t ClockTimeline::frameDelay()
+{
+  if (isPaused || playhead == 0)
+    return TIMELINE_PAUSED_MILLIS;
+  return (uint32_t) timeline[playhead - 1].delay * TIMELINE_TICK_MILLIS *
+    TIMELINE_NORMAL_SPEED / speedPercent;
+}
+
+uint16_t ClockTimeline::position()
+{
+  return playhead;
+}
+
+void ClockTimeline::seek(uint16_t frame)
+{
+  if (frame > frameCount)
+    frame = frameCount;
+  while (playhead < frame) {
+    apply(timeline[playhead++]);
+  }
+  while (playhead > frame) {
+    undo(timeline[--playhead]);
+  }
+}
+
+// Undoing it all and playing it back leaves every cell in the color its
+// frames give it now
+void ClockTimeline::redraw()
+{
+  uint16_t at = playhead;
+  seek(0);
+  seek(at);
+}
+
+void ClockTimeline::setPaused(bool p)
+{
+  isPaused = p;
+}
+
+bool ClockTimeline::paused()
+{
+  return isPaused;
+}
+
+void ClockTimeline::setSpeed(uint16_t percent)
+{
+  speedPercent = constrain(percent, 25, 400);
+}
+
+uint16_t ClockTimeline::speed()
+{
+  return speedPercent;
+}
+
+// Where a cell is in both lists it's cleared and then set again, so it
+// stays lit; undoing goes the other way round for the same reason
+void ClockTimeline::apply(const timelineFrame &f)
+{
+  for (uint8_t i=0; i<(f.counts & 0x0f); i++) {
+    setCell(f.cleared[i], CRGB::Black);
+  }
+  CRGB color = palette[f.colorIndex];
+  for (uint8_t i=0; i<(f.counts >> 4); i++) {
+    setCell(f.set[i], color);
+  }
+}
+
+void ClockTimeline::undo(const timelineFrame &f)
+{
+  for (uint8_t i=0; i<(f.counts >> 4); i++) {
+    setCell(f.set[i], CRGB::Black);
+  }
+  CRGB color = palette[f.colorIndex];
+  for (uint8_t i=0; i<(f.counts & 0x0f); i++) {
+    setCell(f.cleared[i], color);
+  }
+}
+
+void ClockTimeline::setCell(timelineCell c, CRGB color)
+{
+  panel->SetLED(c % DISPLAY_WIDTH, c / DISPLAY_WIDTH, color);
+}
@@ -0,0 +1,85 @@
+#ifndef __CLOCKTIMELINE_H
+#define __CLOCKTIMELINE_H
+
+#include <stdint.h>
+#include "LEDAbstraction.h"
+#include "Palette.h"
+
+// A clock face (or tree) worked out ahead of time: every frame of the
+// pieces dropping in to place, as the cells it clears, the cells it sets
+// and how long to hold it. TetrisClock compiles one whenever the face
+// changes, and nothing changes it after that. Playing it back is a walk
+// along the table, so it can be paused, sped up, or scrubbed either way
+// (a frame is undone by clearing what it set, then setting what it
+// cleared). step() only sets pixels; loop() shows them on its next
+// refresh like everything else.
+
+#define TIMELINE_FRAME_CELLS 4 // one piece's worth
+// The clock and tree are laid out on 32 rows whatever the display is
+// (rows past the bottom of it are left off), and the tree is the
+// longest of them, at 415 frames
+#define TIMELINE_FACE_ROWS 32
+#define TIMELINE_MAX_FRAMES (14 * TIMELINE_FACE_ROWS)
+#define TIMELINE_TICK_MILLIS 10 // frame delays are kept in these
+#define TIMELINE_NORMAL_SPEED 100 // percent
+#define TIMELINE_PAUSED_MILLIS 100 // how often to look again while paused
+
+#if DISPLAY_PIXELS <= 256
+typedef uint8_t timelineCell; // y * DISPLAY_WIDTH + x
+#else
+typedef uint16_t timelineCell;
+#endif
+
+typedef struct _timelineFrame {
+  timelineCell cleared[TIMELINE_FRAME_CELLS];
+  timelineCell set[TIMELINE_FRAME_CELLS];
+  uint8_t counts; // cells cleared in the low nybble, set in the high
+  uint8_t colorIndex; // of the cells that are set
+  uint8_t delay; // ticks until the next frame, at normal speed
+} timelineFrame;
+
+class ClockTimeline {
+ public:
+  ClockTimeline(LEDAbstraction *p);
+
+  // Compiling
+  void clear();
+  bool addFrame(const timelineFrame &f); // false if there's no room; see overflowed()
+  bool addFrame(const timelineCell *cleared, uint8_t clearedCount,
+		const timelineCell *set, uint8_t setCount,
+		uint8_t colorIndex, uint16_t delayMillis);
+  bool overflowed();
+
+  uint16_t frames();
+  uint32_t duration(); // total millis at normal speed
+
+  // Playback
+  bool step(); // draws the next frame; false once they've all been drawn
+  uint32_t frameDelay(); // until the next step(), at the current speed
+  uint16_t position(); // how many frames have been drawn
+  void seek(uint16_t frame); // draws or undoes frames until position() is frame
+  void redraw(); // draws what's been played again, in the current palette
+
+  void setPaused(bool p);
+  bool paused();
+  void setSpeed(uint16_t percent); // kept between 25 and 400
+  uint16_t speed();
+
+ private:
+  void apply(const timelineFrame &f);
+  void undo(const timelineFrame &f);
+  void setCell(timelineCell c, CRGB color);
+
+  LEDAbstraction *panel;
+
+  timelineFrame timeline[TIMELINE_MAX_FRAMES];
+  uint16_t frameCount;
+  uint32_t totalMillis;
+  bool full;
+
+  uint16_t playhead;
+  uint16_t speedPercent;
+  bool isPaused;
+};
+
+#endif
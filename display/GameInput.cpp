@@ -0,0 +1,39 @@
+#include "GameInput.h"
+
+bool tetrisInput(Tetris *t, char c)
+{
+  switch (c) {
+  case 'a':
+    t->MoveLeft();
+    break;
+  case 'd':
+    t->MoveRight();
+    break;
+  case 'q':
+    t->RotateLeft();
+    break;
+  case 'e':
+    t->RotateRight();
+    break;
+  case 's':
+    return t->Step();
+  case ' ':
+    return t->Drop();
+  }
+  return true;
+}
+
+bool snakeInput(Snake *s, char c)
+{
+  switch (c) {
+  case 'a':
+    s->TurnLeft();
+    break;
+  case 'd':
+    s->TurnRight();
+    break;
+  case 's':
+    return s->Step();
+  }
+  return true;
+}
@@ -0,0 +1,15 @@
+#ifndef __GAMEINPUT_H
+#define __GAMEINPUT_H
+
+#include "tetris.h"
+#include "snake.h"
+
+// What each input character does to a game engine. These are shared by
+// the UDP/TCP/HTTP handlers, the attract mode and the host replayer, so
+// that a recorded game replays exactly the way it was played.
+//
+// Both return false if that input ended the game.
+bool tetrisInput(Tetris *t, char c);
+bool snakeInput(Snake *s, char c);
+
+#endif
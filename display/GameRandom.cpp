@@ -0,0 +1,42 @@
+#include "GameRandom.h"
+
+#define DEFAULTSEED 0x2545F491
+
+GameRandom::GameRandom()
+{
+  seed(DEFAULTSEED);
+}
+
+void GameRandom::seed(uint32_t s)
+{
+  // xorshift can't get out of an all-zero state
+  initialSeed = s ? s : DEFAULTSEED;
+  state = initialSeed;
+}
+
+uint32_t GameRandom::getSeed()
+{
+  return initialSeed;
+}
+
+uint32_t GameRandom::next()
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+uint16_t GameRandom::lessThan(uint16_t limit)
+{
+  if (limit <= 1)
+    return 0;
+
+  // Reject the top sliver of the range so every result is equally likely
+  uint32_t bucket = 0xFFFFFFFFUL / limit;
+  uint32_t r;
+  do {
+    r = next() / bucket;
+  } while (r >= limit);
+  return r;
+}
@@ -0,0 +1,23 @@
+#ifndef __GAMERANDOM_H
+#define __GAMERANDOM_H
+
+#include <stdint.h>
+
+// A small seedable PRNG (xorshift32) for the game engines, so that a
+// game can be replayed exactly from its seed and its inputs.
+class GameRandom {
+ public:
+  GameRandom();
+
+  void seed(uint32_t s);
+  uint32_t getSeed();
+
+  uint32_t next();
+  uint16_t lessThan(uint16_t limit); // [0, limit)
+
+ private:
+  uint32_t initialSeed;
+  uint32_t state;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include "GlyphCache.h"
+
+GlyphCache::GlyphCache()
+{
+  currentOrientation = FONT_SIDEWAYS;
+  clear();
+  hitCount = missCount = 0;
+}
+
+void GlyphCache::clear()
+{
+  memset(lastUsed, 0, sizeof(lastUsed));
+  useClock = 0;
+  used = 0;
+}
+
+void GlyphCache::setOrientation(uint8_t o)
+{
+  currentOrientation = (o == FONT_UPRIGHT) ? FONT_UPRIGHT : FONT_SIDEWAYS;
+  clear();
+}
+
+uint8_t GlyphCache::orientation()
+{
+  return currentOrientation;
+}
+
+const glyphSlices *GlyphCache::lookup(uint16_t codepoint)
+{
+  if (++useClock == 0) {
+    // Wrapped; start the ages again, which forgets the order but
+    // not the glyphs
+    memset(lastUsed, 0, sizeof(lastUsed));
+    useClock = 1;
+  }
+
+  uint8_t victim = 0;
+  for (uint8_t i=0; i<used; i++) {
+    if (entries[i].codepoint == codepoint) {
+      hitCount++;
+      lastUsed[i] = useClock;
+      return &entries[i];
+    }
+    if (lastUsed[i] < lastUsed[victim])
+      victim = i;
+  }
+
+  missCount++;
+  if (used < GLYPH_CACHE_SIZE)
+    victim = used++;
+
+  glyphSlices *g = &entries[victim];
+  if (!findSlices(codepoint, currentOrientation, g)) {
+    findSlices(FONT_REPLACEMENT, currentOrientation, g);
+  }
+  // Under the code point asked for, so the next one's a hit too
+  g->codepoint = codepoint;
+  lastUsed[victim] = useClock;
+  return g;
+}
+
+uint32_t GlyphCache::hits()
+{
+  return hitCount;
+}
+
+uint32_t GlyphCache::misses()
+{
+  return missCount;
+}
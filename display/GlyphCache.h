@@ -0,0 +1,39 @@
+#ifndef __GLYPHCACHE_H
+#define __GLYPHCACHE_H
+
+#include <stdint.h>
+#include "GlyphTable.h"
+
+// The last few glyphs looked up, copied out of flash as slices for the
+// orientation text is in, so that a message that keeps using the same
+// handful of letters doesn't keep searching and reading the font for
+// them. Least recently used goes first.
+
+#define GLYPH_CACHE_SIZE 32
+
+class GlyphCache {
+ public:
+  GlyphCache();
+
+  void clear();
+
+  void setOrientation(uint8_t o); // FONT_SIDEWAYS or FONT_UPRIGHT; empties the cache
+  uint8_t orientation();
+
+  // Never NULL: code points the font doesn't cover get FONT_REPLACEMENT
+  const glyphSlices *lookup(uint16_t codepoint);
+
+  uint32_t hits();
+  uint32_t misses();
+
+ private:
+  glyphSlices entries[GLYPH_CACHE_SIZE];
+  uint16_t lastUsed[GLYPH_CACHE_SIZE];
+  uint16_t useClock;
+  uint8_t used;
+  uint8_t currentOrientation;
+  uint32_t hitCount;
+  uint32_t missCount;
+};
+
+#endif
@@ -0,0 +1,350 @@
+#include "GlyphTable.h"
+#include "IndexSequence.h"
+#include "font5x7.h"
+
+// Rows 0-2 of the XPM are its header and colors
+#define XPM_FIRST_ROW 3
+
+constexpr uint8_t xpmBit(uint16_t column, uint8_t y)
+{
+  return (font5x7_xpm[XPM_FIRST_ROW + y][column] == '.') ? (1 << y) : 0;
+}
+
+constexpr uint8_t packColumn(uint16_t column)
+{
+  return xpmBit(column, 0) | xpmBit(column, 1) | xpmBit(column, 2) |
+    xpmBit(column, 3) | xpmBit(column, 4) | xpmBit(column, 5) |
+    xpmBit(column, 6);
+}
+
+static_assert(CHAR_HEIGHT == 7, "packColumn() reads seven rows");
+static_assert(packColumn(('A' - FONT_FIRST_CHAR) * CHAR_WIDTH) == 0x7e &&
+	      packColumn(('A' - FONT_FIRST_CHAR) * CHAR_WIDTH + 1) == 0x11 &&
+	      packColumn(('!' - FONT_FIRST_CHAR) * CHAR_WIDTH + 2) == 0x5f,
+	      "glyphs don't match the XPM font");
+
+// Proportional glyphs
+
+constexpr uint8_t cellColumn(uint8_t ch, uint8_t x)
+{
+  return packColumn((ch - FONT_FIRST_CHAR) * CHAR_WIDTH + x);
+}
+
+constexpr uint8_t firstLit(uint8_t ch, uint8_t x = 0)
+{
+  return (x == CHAR_WIDTH || cellColumn(ch, x)) ? x : firstLit(ch, x + 1);
+}
+
+constexpr uint8_t lastLit(uint8_t ch, uint8_t x = CHAR_WIDTH - 1)
+{
+  return (x == 0 || cellColumn(ch, x)) ? x : lastLit(ch, x - 1);
+}
+
+constexpr bool blankCell(uint8_t ch)
+{
+  return firstLit(ch) == CHAR_WIDTH;
+}
+
+constexpr uint8_t trimmedWidth(uint8_t ch)
+{
+  return blankCell(ch) ? FONT_SPACE_WIDTH : lastLit(ch) - firstLit(ch) + 1;
+}
+
+constexpr uint8_t trimmedColumn(uint8_t ch, uint8_t x)
+{
+  return (blankCell(ch) || x >= trimmedWidth(ch)) ? 0 : cellColumn(ch, firstLit(ch) + x);
+}
+
+constexpr fontGlyph asciiGlyph(uint16_t codepoint, uint8_t ch)
+{
+  return { codepoint, trimmedWidth(ch),
+	   { trimmedColumn(ch, 0), trimmedColumn(ch, 1), trimmedColumn(ch, 2),
+	     trimmedColumn(ch, 3), trimmedColumn(ch, 4) } };
+}
+
+// Upside down, for the Spanish opening marks
+constexpr uint8_t flipColumn(uint8_t c, uint8_t y = 0)
+{
+  return (y == CHAR_HEIGHT) ? 0 :
+    (((c >> y) & 1) << (CHAR_HEIGHT - 1 - y)) | flipColumn(c, y + 1);
+}
+
+constexpr fontGlyph flippedGlyph(uint16_t codepoint, uint8_t ch)
+{
+  return { codepoint, trimmedWidth(ch),
+	   { flipColumn(trimmedColumn(ch, 0)), flipColumn(trimmedColumn(ch, 1)),
+	     flipColumn(trimmedColumn(ch, 2)), flipColumn(trimmedColumn(ch, 3)),
+	     flipColumn(trimmedColumn(ch, 4)) } };
+}
+
+// Marks sit in rows 0-1, centred over the letter, which loses anything
+// it had there (the dot on the i); the cedilla hangs below in row 7
+enum { MARK_GRAVE, MARK_ACUTE, MARK_CIRCUMFLEX, MARK_TILDE, MARK_DIAERESIS,
+       MARK_RING, MARK_CEDILLA };
+
+#define MARK_ROWS 0x03
+
+constexpr uint8_t markWidths[] = { 3, 3, 3, 4, 3, 2, 1 };
+constexpr uint8_t markColumns[][4] = {
+  { 0x01, 0x02, 0x00 },       // grave
+  { 0x00, 0x02, 0x01 },       // acute
+  { 0x02, 0x01, 0x02 },       // circumflex
+  { 0x02, 0x01, 0x02, 0x01 }, // tilde
+  { 0x01, 0x00, 0x01 },       // diaeresis
+  { 0x03, 0x03 },             // ring
+  { 0x80 },                   // cedilla
+};
+
+constexpr uint8_t markColumn(uint8_t mark, uint8_t width, uint8_t x)
+{
+  return (x < (width - markWidths[mark]) / 2 ||
+	  x >= (width - markWidths[mark]) / 2 + markWidths[mark]) ? 0 :
+    markColumns[mark][x - (width - markWidths[mark]) / 2];
+}
+
+constexpr uint8_t accentedColumn(uint8_t ch, uint8_t mark, uint8_t x)
+{
+  return (mark == MARK_CEDILLA ? trimmedColumn(ch, x) :
+	  (trimmedColumn(ch, x) & ~MARK_ROWS)) |
+    (x < trimmedWidth(ch) ? markColumn(mark, trimmedWidth(ch), x) : 0);
+}
+
+constexpr fontGlyph accentedGlyph(uint16_t codepoint, uint8_t ch, uint8_t mark)
+{
+  return { codepoint, trimmedWidth(ch),
+	   { accentedColumn(ch, mark, 0), accentedColumn(ch, mark, 1),
+	     accentedColumn(ch, mark, 2), accentedColumn(ch, mark, 3),
+	     accentedColumn(ch, mark, 4) } };
+}
+
+#define FONT_ASCII_GLYPHS (FONT_LAST_CHAR - FONT_FIRST_CHAR + 1)
+
+typedef struct _asciiGlyphTable {
+  fontGlyph glyphs[FONT_ASCII_GLYPHS];
+} asciiGlyphTable;
+
+template<uint16_t... I>
+constexpr asciiGlyphTable buildAsciiGlyphs(indexSeq<I...>)
+{
+  return { { asciiGlyph(FONT_FIRST_CHAR + I, FONT_FIRST_CHAR + I)... } };
+}
+
+static constexpr asciiGlyphTable asciiGlyphs PROGMEM = buildAsciiGlyphs(makeIndexSeq<FONT_ASCII_GLYPHS>::type());
+
+static_assert(trimmedWidth('A') == 5 && trimmedWidth('i') == 3 &&
+	      trimmedWidth('!') == 1 && trimmedWidth(' ') == FONT_SPACE_WIDTH,
+	      "trimmed widths don't match the XPM font");
+constexpr bool asciiFits(uint8_t ch = FONT_FIRST_CHAR)
+{
+  return ch > FONT_LAST_CHAR || (trimmedWidth(ch) <= FONT_MAX_WIDTH && asciiFits(ch + 1));
+}
+
+static_assert(asciiFits(), "a glyph is wider than FONT_MAX_WIDTH");
+
+// Everything else the font covers, in code point order
+static constexpr fontGlyph extraGlyphs[] PROGMEM = {
+  asciiGlyph(0x00a0, ' '),          // no-break space
+  flippedGlyph(0x00a1, '!'),
+  { 0x00a3, 5, { 0x48, 0x7e, 0x49, 0x41, 0x42 } }, // pound
+  { 0x00b0, 3, { 0x02, 0x05, 0x02 } },             // degree
+  { 0x00b1, 5, { 0x48, 0x48, 0x5e, 0x48, 0x48 } }, // plus-minus
+  { 0x00b7, 1, { 0x08 } },                         // middle dot
+  flippedGlyph(0x00bf, '?'),
+  asciiGlyph(0x00c0, 'A'), asciiGlyph(0x00c1, 'A'), asciiGlyph(0x00c2, 'A'),
+  asciiGlyph(0x00c3, 'A'), asciiGlyph(0x00c4, 'A'), asciiGlyph(0x00c5, 'A'),
+  asciiGlyph(0x00c7, 'C'),
+  asciiGlyph(0x00c8, 'E'), asciiGlyph(0x00c9, 'E'), asciiGlyph(0x00ca, 'E'),
+  asciiGlyph(0x00cb, 'E'),
+  asciiGlyph(0x00cc, 'I'), asciiGlyph(0x00cd, 'I'), asciiGlyph(0x00ce, 'I'),
+  asciiGlyph(0x00cf, 'I'),
+  asciiGlyph(0x00d1, 'N'),
+  asciiGlyph(0x00d2, 'O'), asciiGlyph(0x00d3, 'O'), asciiGlyph(0x00d4, 'O'),
+  asciiGlyph(0x00d5, 'O'), asciiGlyph(0x00d6, 'O'),
+  { 0x00d7, 5, { 0x44, 0x28, 0x10, 0x28, 0x44 } }, // multiplication
+  asciiGlyph(0x00d8, 'O'),
+  asciiGlyph(0x00d9, 'U'), asciiGlyph(0x00da, 'U'), asciiGlyph(0x00db, 'U'),
+  asciiGlyph(0x00dc, 'U'),
+  asciiGlyph(0x00dd, 'Y'),
+  { 0x00df, 4, { 0x7e, 0x01, 0x25, 0x1a } },       // sharp s
+  accentedGlyph(0x00e0, 'a', MARK_GRAVE), accentedGlyph(0x00e1, 'a', MARK_ACUTE),
+  accentedGlyph(0x00e2, 'a', MARK_CIRCUMFLEX), accentedGlyph(0x00e3, 'a', MARK_TILDE),
+  accentedGlyph(0x00e4, 'a', MARK_DIAERESIS), accentedGlyph(0x00e5, 'a', MARK_RING),
+  accentedGlyph(0x00e7, 'c', MARK_CEDILLA),
+  accentedGlyph(0x00e8, 'e', MARK_GRAVE), accentedGlyph(0x00e9, 'e', MARK_ACUTE),
+  accentedGlyph(0x00ea, 'e', MARK_CIRCUMFLEX), accentedGlyph(0x00eb, 'e', MARK_DIAERESIS),
+  accentedGlyph(0x00ec, 'i', MARK_GRAVE), accentedGlyph(0x00ed, 'i', MARK_ACUTE),
+  accentedGlyph(0x00ee, 'i', MARK_CIRCUMFLEX), accentedGlyph(0x00ef, 'i', MARK_DIAERESIS),
+  accentedGlyph(0x00f1, 'n', MARK_TILDE),
+  accentedGlyph(0x00f2, 'o', MARK_GRAVE), accentedGlyph(0x00f3, 'o', MARK_ACUTE),
+  accentedGlyph(0x00f4, 'o', MARK_CIRCUMFLEX), accentedGlyph(0x00f5, 'o', MARK_TILDE),
+  accentedGlyph(0x00f6, 'o', MARK_DIAERESIS),
+  { 0x00f7, 5, { 0x10, 0x10, 0x54, 0x10, 0x10 } }, // division
+  asciiGlyph(0x00f8, 'o'),
+  accentedGlyph(0x00f9, 'u', MARK_GRAVE), accentedGlyph(0x00fa, 'u', MARK_ACUTE),
+  accentedGlyph(0x00fb, 'u', MARK_CIRCUMFLEX), accentedGlyph(0x00fc, 'u', MARK_DIAERESIS),
+  accentedGlyph(0x00fd, 'y', MARK_ACUTE),
+  accentedGlyph(0x00ff, 'y', MARK_DIAERESIS),
+  asciiGlyph(0x2013, '-'), asciiGlyph(0x2014, '-'),  // dashes
+  asciiGlyph(0x2018, '\''), asciiGlyph(0x2019, '\''), // quotes
+  asciiGlyph(0x201c, '"'), asciiGlyph(0x201d, '"'),
+  { 0x2022, 3, { 0x08, 0x1c, 0x08 } },             // bullet
+  { 0x2026, 5, { 0x40, 0x00, 0x40, 0x00, 0x40 } }, // ellipsis
+  { 0x20ac, 5, { 0x14, 0x3e, 0x55, 0x55, 0x41 } }, // euro
+  { 0x2190, 5, { 0x08, 0x1c, 0x2a, 0x08, 0x08 } }, // left arrow
+  { 0x2192, 5, { 0x08, 0x08, 0x2a, 0x1c, 0x08 } }, // right arrow
+  { 0x2665, 5, { 0x0c, 0x1e, 0x3c, 0x1e, 0x0c } }, // heart
+};
+
+#define FONT_EXTRA_GLYPHS (sizeof(extraGlyphs) / sizeof(extraGlyphs[0]))
+
+constexpr bool extrasSorted(uint16_t i = 1)
+{
+  return i >= FONT_EXTRA_GLYPHS ||
+    (extraGlyphs[i - 1].codepoint < extraGlyphs[i].codepoint && extrasSorted(i + 1));
+}
+
+static_assert(extrasSorted(), "extraGlyphs must be in code point order");
+static_assert(extraGlyphs[0].codepoint > FONT_LAST_CHAR, "extraGlyphs overlaps ASCII");
+
+// Glyphs are numbered ASCII first, then the extras; the atlas is in
+// the same order
+#define FONT_ALL_GLYPHS (FONT_ASCII_GLYPHS + FONT_EXTRA_GLYPHS)
+
+static int16_t glyphIndex(uint16_t codepoint)
+{
+  if (codepoint >= FONT_FIRST_CHAR && codepoint <= FONT_LAST_CHAR)
+    return codepoint - FONT_FIRST_CHAR;
+
+  int lo = 0, hi = FONT_EXTRA_GLYPHS - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    uint16_t c = pgm_read_word(&extraGlyphs[mid].codepoint);
+    if (c == codepoint)
+      return FONT_ASCII_GLYPHS + mid;
+    if (c < codepoint)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+  return -1;
+}
+
+static const fontGlyph *glyphAddress(int16_t index)
+{
+  return (index < FONT_ASCII_GLYPHS) ? &asciiGlyphs.glyphs[index] :
+    &extraGlyphs[index - FONT_ASCII_GLYPHS];
+}
+
+bool findGlyph(uint16_t codepoint, fontGlyph *g)
+{
+  int16_t index = glyphIndex(codepoint);
+  if (index < 0)
+    return false;
+  memcpy_P(g, glyphAddress(index), sizeof(*g));
+  return true;
+}
+
+// The upright atlas
+
+constexpr fontGlyph glyphAt(uint16_t index)
+{
+  return (index < FONT_ASCII_GLYPHS) ? asciiGlyphs.glyphs[index] :
+    extraGlyphs[index - FONT_ASCII_GLYPHS];
+}
+
+// Glyph column x lands at panel x = offset+x, which is bit 7-offset-x
+constexpr uint8_t uprightBit(const fontGlyph &g, uint8_t y, uint8_t x)
+{
+  return (x < g.width && ((g.columns[x] >> y) & 1)) ?
+    (0x80 >> ((FONT_UPRIGHT_HEIGHT - g.width) / 2 + x)) : 0;
+}
+
+constexpr uint8_t uprightRow(const fontGlyph &g, uint8_t y)
+{
+  return uprightBit(g, y, 0) | uprightBit(g, y, 1) | uprightBit(g, y, 2) |
+    uprightBit(g, y, 3) | uprightBit(g, y, 4);
+}
+
+static_assert(FONT_MAX_WIDTH == 5, "uprightRow() reads five columns");
+static_assert(FONT_MAX_SLICES >= FONT_MAX_WIDTH && FONT_MAX_SLICES >= FONT_UPRIGHT_HEIGHT,
+	      "FONT_MAX_SLICES doesn't fit a glyph");
+
+typedef struct _uprightAtlas {
+  uint8_t rows[FONT_ALL_GLYPHS * FONT_UPRIGHT_HEIGHT];
+} uprightAtlas;
+
+template<uint16_t... I>
+constexpr uprightAtlas buildUprightAtlas(indexSeq<I...>)
+{
+  return { { uprightRow(glyphAt(I / FONT_UPRIGHT_HEIGHT), I % FONT_UPRIGHT_HEIGHT)... } };
+}
+
+static constexpr uprightAtlas uprightGlyphs PROGMEM =
+  buildUprightAtlas(makeIndexSeq<FONT_ALL_GLYPHS * FONT_UPRIGHT_HEIGHT>::type());
+
+static_assert(uprightGlyphs.rows[('T' - FONT_FIRST_CHAR) * FONT_UPRIGHT_HEIGHT] == 0x7c &&
+	      uprightGlyphs.rows[('T' - FONT_FIRST_CHAR) * FONT_UPRIGHT_HEIGHT + 1] == 0x10,
+	      "the upright atlas is turned the wrong way");
+
+bool findSlices(uint16_t codepoint, uint8_t orientation, glyphSlices *s)
+{
+  int16_t index = glyphIndex(codepoint);
+  if (index < 0)
+    return false;
+
+  s->codepoint = codepoint;
+  if (orientation == FONT_UPRIGHT) {
+    const uint8_t *rows = &uprightGlyphs.rows[index * FONT_UPRIGHT_HEIGHT];
+    memcpy_P(s->slices, rows, FONT_UPRIGHT_HEIGHT);
+    s->count = s->slices[FONT_UPRIGHT_HEIGHT - 1] ? FONT_UPRIGHT_HEIGHT : CHAR_HEIGHT;
+  } else {
+    const fontGlyph *g = glyphAddress(index);
+    s->count = pgm_read_byte(&g->width);
+    memcpy_P(s->slices, g->columns, FONT_MAX_WIDTH);
+  }
+  return true;
+}
+
+// Pairs that fit together without the column of space: the first
+// glyph's last column and the second's first never touch
+#define KERN(a, b) (((a) << 8) | (b))
+
+static constexpr uint16_t kernedPairs[] PROGMEM = {
+  KERN('F', ','), KERN('F', '.'), KERN('F', 'a'), KERN('F', 'e'), KERN('F', 'o'),
+  KERN('L', 'T'), KERN('L', 'Y'),
+  KERN('P', ','), KERN('P', '.'), KERN('P', 'a'),
+  KERN('T', ','), KERN('T', '.'), KERN('T', 'a'), KERN('T', 'c'), KERN('T', 'e'),
+  KERN('T', 'o'), KERN('T', 'r'), KERN('T', 's'), KERN('T', 'u'), KERN('T', 'y'),
+  KERN('Y', ','), KERN('Y', '.'), KERN('Y', 'a'),
+  KERN('r', '.'),
+};
+
+#define FONT_KERNED_PAIRS (sizeof(kernedPairs) / sizeof(kernedPairs[0]))
+
+constexpr bool kernsSorted(uint16_t i = 1)
+{
+  return i >= FONT_KERNED_PAIRS ||
+    (kernedPairs[i - 1] < kernedPairs[i] && kernsSorted(i + 1));
+}
+
+static_assert(kernsSorted(), "kernedPairs must be in order");
+
+bool kernedPair(uint16_t left, uint16_t right)
+{
+  if (left > FONT_LAST_CHAR || right > FONT_LAST_CHAR)
+    return false;
+
+  uint16_t key = KERN(left, right);
+  int lo = 0, hi = FONT_KERNED_PAIRS - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    uint16_t k = pgm_read_word(&kernedPairs[mid]);
+    if (k == key)
+      return true;
+    if (k < key)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+  return false;
+}
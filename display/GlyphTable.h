@@ -0,0 +1,61 @@
+#ifndef __GLYPHTABLE_H
+#define __GLYPHTABLE_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// The 5x7 font comes from font5x7.h, one fixed cell per character; the
+// XPM is only read at compile time, and never makes it in to the
+// firmware.
+
+#define CHAR_WIDTH 6 // including the column of space after each glyph
+#define CHAR_HEIGHT 7
+
+#define FONT_FIRST_CHAR ' '
+
+// The proportional font that text is drawn in: each code point it
+// covers has its own width, with its blank columns trimmed off, and one
+// column of space goes between glyphs unless the pair is kerned
+// together. ASCII comes from the XPM; accented Latin-1 letters are the
+// base letter with a mark in the two rows above the x-height (capitals
+// have no room, so they're just the base letter), and a few symbols are
+// drawn by hand. All of it is built at compile time in to flash.
+
+#define FONT_MAX_WIDTH 5
+#define FONT_SPACE_WIDTH 2
+#define FONT_LAST_CHAR '~'
+#define FONT_REPLACEMENT '?' // drawn for code points the font doesn't cover
+
+typedef struct _fontGlyph {
+  uint16_t codepoint;
+  uint8_t width;
+  uint8_t columns[FONT_MAX_WIDTH]; // bit y is row y; row 7 is below the baseline
+} fontGlyph;
+
+bool findGlyph(uint16_t codepoint, fontGlyph *g); // false if the font doesn't cover it
+bool kernedPair(uint16_t left, uint16_t right); // true if no space goes between them
+
+// Text normally reads sideways on the panel: the glyph's columns run
+// along the long axis, so it reads with the panel on its side. Upright,
+// the glyphs are turned a quarter turn and stacked down the long axis.
+// Either way what scrolls is a run of slices, one byte across the panel
+// each (bit b is lit at x = 7-b): the glyph's columns sideways, and its
+// rows upright. The upright rows come from an atlas of the whole font,
+// turned and centred at compile time; row 7 is only sent for glyphs that
+// reach below the baseline.
+
+#define FONT_SIDEWAYS 0
+#define FONT_UPRIGHT 1
+
+#define FONT_UPRIGHT_HEIGHT 8 // rows per glyph in the atlas
+#define FONT_MAX_SLICES 8 // the most either way round
+
+typedef struct _glyphSlices {
+  uint16_t codepoint;
+  uint8_t count;
+  uint8_t slices[FONT_MAX_SLICES];
+} glyphSlices;
+
+bool findSlices(uint16_t codepoint, uint8_t orientation, glyphSlices *s); // false if the font doesn't cover it
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __INDEXSEQUENCE_H
+#define __INDEXSEQUENCE_H
+
+#include <stdint.h>
+
+// A compile-time list of indices 0..N-1, for building lookup tables
+// with constexpr functions (std::index_sequence is C++14, and this core
+// is C++11). The list is built by halves, so the template depth is only
+// log2(N).
+
+template<uint16_t... I> struct indexSeq {};
+
+template<class A, class B> struct concatIndexSeq;
+template<uint16_t... A, uint16_t... B>
+struct concatIndexSeq<indexSeq<A...>, indexSeq<B...> > {
+  typedef indexSeq<A..., (uint16_t)(sizeof...(A) + B)...> type;
+};
+
+template<uint16_t N> struct makeIndexSeq {
+  typedef typename concatIndexSeq<typename makeIndexSeq<N/2>::type,
+				  typename makeIndexSeq<N - N/2>::type>::type type;
+};
+template<> struct makeIndexSeq<0> { typedef indexSeq<> type; };
+template<> struct makeIndexSeq<1> { typedef indexSeq<0> type; };
+
+#endif
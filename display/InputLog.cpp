@@ -0,0 +1,160 @@
+#include "InputLog.h"
+
+#include <string.h>
+
+InputLog::InputLog()
+{
+  sink = 0;
+  used = 0;
+  recording = false;
+  currentGame = 0;
+  events = 0;
+}
+
+InputLog::~InputLog()
+{
+}
+
+void InputLog::setSink(inputLogSink s)
+{
+  sink = s;
+}
+
+bool InputLog::isRecording()
+{
+  return recording;
+}
+
+uint8_t InputLog::game()
+{
+  return currentGame;
+}
+
+uint32_t InputLog::eventCount()
+{
+  return events;
+}
+
+void InputLog::begin(uint8_t game, uint32_t seed, uint32_t now)
+{
+  used = 0;
+  events = 0;
+  firstFlush = true;
+  recording = true;
+  currentGame = game;
+  lastTick = now;
+
+  addByte('T');
+  addByte('L');
+  addByte(INPUTLOG_VERSION);
+  addByte(game);
+  addLong(seed);
+}
+
+void InputLog::record(uint32_t now, uint8_t c)
+{
+  if (!recording || c == INPUTLOG_END)
+    return;
+
+  addVarint(now - lastTick);
+  addByte(c);
+  lastTick = now;
+  events++;
+}
+
+void InputLog::end(uint32_t now, uint32_t boardHash)
+{
+  if (!recording)
+    return;
+
+  addVarint(now - lastTick);
+  addByte(INPUTLOG_END);
+  addLong(boardHash);
+  flush();
+  recording = false;
+}
+
+void InputLog::addByte(uint8_t b)
+{
+  if (used == INPUTLOG_BUFSIZE)
+    flush();
+  buffer[used++] = b;
+}
+
+// 7 bits per byte, low bits first; the high bit means "more follows"
+void InputLog::addVarint(uint32_t v)
+{
+  while (v >= 0x80) {
+    addByte((v & 0x7F) | 0x80);
+    v >>= 7;
+  }
+  addByte(v);
+}
+
+void InputLog::addLong(uint32_t v)
+{
+  for (int i=0; i<4; i++) {
+    addByte(v & 0xFF);
+    v >>= 8;
+  }
+}
+
+void InputLog::flush()
+{
+  if (sink && used) {
+    sink(buffer, used, firstFlush);
+    firstFlush = false;
+  }
+  used = 0;
+}
+
+static uint32_t readLong(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+    ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool inputLogParseHeader(const uint8_t *data, uint32_t len,
+			 uint8_t *game, uint32_t *seed)
+{
+  if (len < INPUTLOG_HEADERSIZE || data[0] != 'T' || data[1] != 'L' ||
+      data[2] != INPUTLOG_VERSION)
+    return false;
+
+  *game = data[3];
+  *seed = readLong(&data[4]);
+  return true;
+}
+
+bool inputLogNextEvent(const uint8_t *data, uint32_t len, uint32_t *pos,
+		       inputLogEvent *ev)
+{
+  if (*pos < INPUTLOG_HEADERSIZE) {
+    *pos = INPUTLOG_HEADERSIZE;
+    ev->tick = 0;
+  }
+
+  uint32_t delta = 0;
+  uint8_t shift = 0;
+  while (true) {
+    if (*pos >= len || shift > 28)
+      return false;
+    uint8_t b = data[(*pos)++];
+    delta |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80))
+      break;
+    shift += 7;
+  }
+  if (*pos >= len)
+    return false;
+
+  ev->tick += delta;
+  ev->input = data[(*pos)++];
+  if (ev->input == INPUTLOG_END) {
+    if (*pos + 4 > len)
+      return false;
+    ev->hash = readLong(&data[*pos]);
+    *pos += 4;
+  }
+  return true;
+}
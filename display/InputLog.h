@@ -0,0 +1,73 @@
+#ifndef __INPUTLOG_H
+#define __INPUTLOG_H
+
+#include <stdint.h>
+
+// A compact binary log of the inputs that drove a game, so it can be
+// replayed (and benchmarked) off-device. The format is:
+//
+//   header:  'T' 'L' <version> <game> <seed, 4 bytes LE>
+//   events:  <ticks since previous event, varint> <input byte>
+//   trailer: <ticks, varint> 0x00 <board hash, 4 bytes LE>
+//
+// Input bytes are the same characters handleChar() takes; timed
+// engine steps are logged as 's'. Ticks are milliseconds.
+
+#define INPUTLOG_VERSION 1
+#define INPUTLOG_HEADERSIZE 8
+#define INPUTLOG_END 0x00
+
+#define INPUTLOG_TETRIS 'T'
+#define INPUTLOG_SNAKE  'S'
+
+// The log is buffered in RAM and handed to the sink whenever the buffer
+// fills (and when the game ends)
+#define INPUTLOG_BUFSIZE 256
+
+typedef void (*inputLogSink)(const uint8_t *data, uint16_t len, bool first);
+
+class InputLog {
+ public:
+  InputLog();
+  ~InputLog();
+
+  void setSink(inputLogSink s);
+
+  void begin(uint8_t game, uint32_t seed, uint32_t now);
+  void record(uint32_t now, uint8_t c);
+  void end(uint32_t now, uint32_t boardHash);
+
+  bool isRecording();
+  uint8_t game();
+  uint32_t eventCount();
+
+ private:
+  void addByte(uint8_t b);
+  void addVarint(uint32_t v);
+  void addLong(uint32_t v);
+  void flush();
+
+  inputLogSink sink;
+  uint8_t buffer[INPUTLOG_BUFSIZE];
+  uint16_t used;
+  bool firstFlush;
+  bool recording;
+  uint8_t currentGame;
+  uint32_t lastTick;
+  uint32_t events;
+};
+
+// Decoding, for the replayer. Returns false at the end of the log (or
+// if it's malformed).
+typedef struct _inputLogEvent {
+  uint32_t tick;  // absolute, from the start of the log
+  uint8_t input;  // INPUTLOG_END for the trailer
+  uint32_t hash;  // only valid in the trailer
+} inputLogEvent;
+
+bool inputLogParseHeader(const uint8_t *data, uint32_t len,
+			 uint8_t *game, uint32_t *seed);
+bool inputLogNextEvent(const uint8_t *data, uint32_t len, uint32_t *pos,
+		       inputLogEvent *ev);
+
+#endif
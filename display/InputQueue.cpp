@@ -0,0 +1,93 @@
+#include "InputQueue.h"
+
+static_assert((INPUTQUEUESIZE & (INPUTQUEUESIZE - 1)) == 0,
+	      "INPUTQUEUESIZE must be a power of two");
+static_assert(INPUTQUEUESIZE < 256, "INPUTQUEUESIZE must fit in a uint8_t");
+
+InputQueue::InputQueue()
+{
+  clear();
+  highWater = 0;
+  longestWait = 0;
+  dropped = 0;
+}
+
+void InputQueue::clear()
+{
+  head = 0;
+  count = 0;
+}
+
+bool InputQueue::push(char c, uint8_t source, uint32_t now)
+{
+  if (count == INPUTQUEUESIZE) {
+    dropped++;
+    return false;
+  }
+
+  inputEvent *e = &events[(head + count) & (INPUTQUEUESIZE - 1)];
+  e->c = c;
+  e->source = source;
+  e->at = now;
+  count++;
+  if (count > highWater) {
+    highWater = count;
+  }
+  return true;
+}
+
+uint8_t InputQueue::pushBatch(const uint8_t *data, uint16_t len, uint8_t source, uint32_t now)
+{
+  uint8_t queued = 0;
+  for (uint16_t i=0; i<len; i++) {
+    if (push(data[i], source, now)) {
+      queued++;
+    }
+  }
+  return queued;
+}
+
+bool InputQueue::pop(inputEvent *e, uint32_t now)
+{
+  if (!count) {
+    return false;
+  }
+
+  *e = events[head];
+  head = (head + 1) & (INPUTQUEUESIZE - 1);
+  count--;
+
+  uint32_t waited = now - e->at;
+  if (waited > longestWait) {
+    longestWait = waited;
+  }
+  return true;
+}
+
+uint8_t InputQueue::depth()
+{
+  return count;
+}
+
+uint32_t InputQueue::oldestAge(uint32_t now)
+{
+  if (!count) {
+    return 0;
+  }
+  return now - events[head].at;
+}
+
+uint8_t InputQueue::maxDepth()
+{
+  return highWater;
+}
+
+uint32_t InputQueue::maxAge()
+{
+  return longestWait;
+}
+
+uint32_t InputQueue::drops()
+{
+  return dropped;
+}
@@ -0,0 +1,50 @@
+#ifndef __INPUTQUEUE_H
+#define __INPUTQUEUE_H
+
+#include <stdint.h>
+
+// A bounded ring of input events. loop() drains everything the network
+// has for us in to this on each pass, then applies the events in the
+// order they arrived.
+
+#define INPUTQUEUESIZE 32 // must be a power of two
+
+// Where an event came from, which decides how it's applied
+#define INPUT_REMOTE 0 // UDP or TCP remote; goes through handleChar()
+#define INPUT_GAME   1 // web game controls; only ever game moves
+
+typedef struct _inputEvent {
+  char c;
+  uint8_t source;
+  uint32_t at; // millis() when it arrived
+} inputEvent;
+
+class InputQueue {
+ public:
+  InputQueue();
+
+  void clear();
+
+  bool push(char c, uint8_t source, uint32_t now); // false if full (and dropped)
+  uint8_t pushBatch(const uint8_t *data, uint16_t len, uint8_t source, uint32_t now); // returns # queued
+  bool pop(inputEvent *e, uint32_t now);
+
+  uint8_t depth();
+  uint32_t oldestAge(uint32_t now);
+
+  // Statistics since boot
+  uint8_t maxDepth();
+  uint32_t maxAge(); // longest any event waited before it was applied
+  uint32_t drops();
+
+ private:
+  inputEvent events[INPUTQUEUESIZE];
+  uint8_t head; // next to pop
+  uint8_t count;
+
+  uint8_t highWater;
+  uint32_t longestWait;
+  uint32_t dropped;
+};
+
+#endif
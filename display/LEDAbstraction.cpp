@@ -4,155 +4,345 @@
 
 LEDAbstraction::LEDAbstraction()
 {
+  showMicros = 0;
+  isFadeMode = false;
+  numFading = 0;
+  for (uint16_t i=0; i<DISPLAY_PIXELS; i++) {
+    fadeProgress[i] = FADE_DONE;
+  }
+  effect = EFFECT_NONE;
+  effectHue = 0;
+  effectLevel = 255;
+  outgoing = NULL;
+  outgoingCover = NULL;
+  numOverlay = 0;
+  markAllRows();
+  brightness = 0;
+  dirty = true;
+  shows = skippedShows = 0;
+  rateWindowStart = 0;
+  rateWindowShows = lastShowRate = 0;
 }
 
 LEDAbstraction::~LEDAbstraction()
 {
 }
 
-void LEDAbstraction::clear(bool suppressRedraw)
+// Blanks the base layer immediately, even in fade mode; the next
+// Update() shows it
+void LEDAbstraction::clear()
 {
-  for (int i=0; i<NUM_LEDS; i++) {
-    leds[i] = CRGB::Black;
+  for (uint16_t i=0; i<numFading; i++) {
+    fadeProgress[fadingPixels[i]] = FADE_DONE;
   }
-  if (!suppressRedraw)
-    FastLED.show();
+  numFading = 0;
+  for (uint16_t i=0; i<DISPLAY_PIXELS; i++) {
+    baseLayer[i] = fadedLayer[i] = CRGB::Black;
+  }
+  markAllRows();
 }
 
-// disables fademode
-void LEDAbstraction::clearByScrolling()
+void LEDAbstraction::Init()
 {
-  isFadeMode = false;
+  setFadeMode(false);
+
+  FastLED.addLeds<WS2812,LED_PIN,GRB>(leds,NUM_LEDS);
+  setBrightness(40);
+}
+
+void LEDAbstraction::Update()
+{
+  stepFader();
+  composite();
+  showIfChanged();
+}
 
-  for (int count=0; count<32; count++) {
-    for (int y=31; y>=1; y--) {
-      for (int x=0; x<8; x++) {
-	SetLED(x,y,GetLED(x,y-1));
+void LEDAbstraction::markRow(uint8_t y)
+{
+  dirtyRows[y >> 3] |= 1 << (y & 7);
+  anyRowDirty = true;
+}
+
+void LEDAbstraction::markAllRows()
+{
+  for (uint8_t i=0; i<sizeof(dirtyRows); i++) {
+    dirtyRows[i] = 0xFF;
+  }
+  anyRowDirty = true;
+}
+
+// Rebuilds the output for every row that changed since the last frame
+void LEDAbstraction::composite()
+{
+  if (!anyRowDirty)
+    return;
+
+  CRGB wheel = CHSV(effectHue, 255, 255);
+  for (uint8_t y=0; y<DISPLAY_HEIGHT; y++) {
+    if (!(dirtyRows[y >> 3] & (1 << (y & 7))))
+      continue;
+    const CRGB *row = &fadedLayer[y * DISPLAY_WIDTH];
+    for (uint8_t x=0; x<DISPLAY_WIDTH; x++) {
+      CRGB c = row[x];
+      if (outgoing) {
+	uint16_t p = y * DISPLAY_WIDTH + x;
+	uint8_t cover = outgoingCover[p];
+	if (cover == 255) {
+	  c = outgoing[p];
+	} else if (cover) {
+	  nblend(c, outgoing[p], cover);
+	}
+      }
+      if (effect == EFFECT_COLORWHEEL &&
+	  (c.raw[0] != 0 || c.raw[1] != 0 || c.raw[2] != 0)) {
+	c = wheel;
+      }
+      if (effectLevel != 255) {
+	c.nscale8_video(effectLevel);
+      }
+      uint16_t i = panelIndex(x, y);
+      if (leds[i] != c) {
+	leds[i] = c;
+	dirty = true;
       }
     }
-    for (int x=0; x<8; x++) {
-      SetLED(x, 0, CRGB::Black);
+  }
+
+  for (uint8_t i=0; i<numOverlay; i++) {
+    uint8_t y = overlay[i].y;
+    if (!(dirtyRows[y >> 3] & (1 << (y & 7))))
+      continue;
+    uint16_t p = panelIndex(overlay[i].x, y);
+    if (leds[p] != overlay[i].color) {
+      leds[p] = overlay[i].color;
+      dirty = true;
     }
-    Update();
   }
+
+  for (uint8_t i=0; i<sizeof(dirtyRows); i++) {
+    dirtyRows[i] = 0;
+  }
+  anyRowDirty = false;
 }
 
-void LEDAbstraction::Init()
+// With FASTLED_ALLOW_INTERRUPTS 0 every show holds interrupts off for
+// ~30us per LED, so don't push a frame the panel is already displaying.
+void LEDAbstraction::showIfChanged()
 {
-  isFadeMode = false;
-
-  FastLED.addLeds<WS2812,LED_PIN,GRB>(leds,NUM_LEDS);
-  FastLED.setBrightness(40);
+  if (!dirty) {
+    skippedShows++;
+    return;
+  }
+  show();
 }
 
-void LEDAbstraction::Update()
+void LEDAbstraction::show()
 {
-  stepFader();
+  uint32_t start = micros();
   FastLED.show();
+  showMicros = micros() - start;
+  dirty = false;
+
+  shows++;
+  rateWindowShows++;
+  uint32_t now = millis();
+  if (now - rateWindowStart >= 1000) {
+    lastShowRate = rateWindowShows;
+    rateWindowShows = 0;
+    rateWindowStart = now;
+  }
+}
+
+uint32_t LEDAbstraction::lastShowMicros()
+{
+  return showMicros;
+}
+
+uint32_t LEDAbstraction::showCount()
+{
+  return shows;
+}
+
+uint32_t LEDAbstraction::skippedShowCount()
+{
+  return skippedShows;
+}
+
+// Shows in the last full second; 0 once the panel has been idle that long
+uint16_t LEDAbstraction::showsPerSecond()
+{
+  if (millis() - rateWindowStart >= 2000)
+    return 0;
+  return lastShowRate;
 }
 
 void LEDAbstraction::SetLED(uint8_t x, uint8_t y, CRGB color)
 {
-  uint16_t targetPixel = (y&1) ? (8*(y) + x) : (8 * (y+1)-x-1);
-  if (isFadeMode) {
-    targetLEDs[targetPixel] = color;
-    blendPoint = 0;
-  } else {
-    leds[targetPixel] = color;
+  if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT)
+    return;
+  setPixel(y * DISPLAY_WIDTH + x, color);
+}
+
+// Changing a pixel restarts only that pixel's fade
+void LEDAbstraction::setPixel(uint16_t pixel, CRGB color)
+{
+  if (baseLayer[pixel] == color)
+    return;
+  baseLayer[pixel] = color;
+
+  if (!isFadeMode) {
+    fadedLayer[pixel] = color;
+    markRow(pixel / DISPLAY_WIDTH);
+    return;
   }
+  if (fadeProgress[pixel] == FADE_DONE) {
+    fadingPixels[numFading++] = pixel;
+  }
+  fadeProgress[pixel] = 0;
 }
 
 CRGB LEDAbstraction::GetLED(uint8_t x, uint8_t y)
 {
-  uint16_t targetPixel = (y&1) ? (8*(y) + x) : (8 * (y+1)-x-1);
-  if (isFadeMode) {
-    //    return leds[targetPixel];
-    return targetLEDs[targetPixel];
-  } else {
-    return leds[targetPixel];
-  }
+  if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT)
+    return CRGB::Black;
+  return baseLayer[y * DISPLAY_WIDTH + x];
 }
 
+// The base layer always holds the finished frame, so neither direction
+// needs a full copy: turning fading off just lands the pixels in flight
 void LEDAbstraction::setFadeMode(bool f)
 {
   isFadeMode = f;
-  if (f) {
-    // set fade state from the current state when we turn on fading mode
-    for (uint16_t i=0; i<NUM_LEDS; i++) {
-      targetLEDs[i] = leds[i];
-    }
-    blendPoint = 0;
-  } else {
-    for (uint16_t i=0; i<NUM_LEDS; i++) {
-      leds[i] = targetLEDs[i];
-    }
+  if (!f) {
+    finishFades();
   }
 }
 
-// Helper function that blends one uint8_t toward another by a given amount
-static void nblendU8TowardU8( uint8_t& cur, const uint8_t target, uint8_t amount)
+bool LEDAbstraction::fadeMode()
+{
+  return isFadeMode;
+}
+
+void LEDAbstraction::finishFades()
 {
-  if( cur == target) return;
-  
-  if( cur < target ) {
-    uint8_t delta = target - cur;
-    delta = scale8_video( delta, amount);
-    cur += delta;
-  } else {
-    uint8_t delta = cur - target;
-    delta = scale8_video( delta, amount);
-    cur -= delta;
+  for (uint16_t i=0; i<numFading; i++) {
+    uint16_t pixel = fadingPixels[i];
+    fadedLayer[pixel] = baseLayer[pixel];
+    fadeProgress[pixel] = FADE_DONE;
+    markRow(pixel / DISPLAY_WIDTH);
   }
+  numFading = 0;
 }
-static CRGB fadeTowardColor( CRGB& cur, const CRGB& target, uint8_t amount)
+
+uint16_t LEDAbstraction::fadingCount()
 {
-  nblendU8TowardU8( cur.red,   target.red,   amount);
-  nblendU8TowardU8( cur.green, target.green, amount);
-  nblendU8TowardU8( cur.blue,  target.blue,  amount);
-  return cur;
+  return numFading;
 }
 
 extern void WLOG(uint8_t x);
 
+// Cost is proportional to the number of pixels still converging
 void LEDAbstraction::stepFader()
 {
-  if (!isFadeMode)
-    return;
-
   WLOG(200);
-  if (blendPoint < 255) {
-    blendPoint += 75;
-    if (blendPoint > 255) {
-      blendPoint = 255;
+  uint16_t i = 0;
+  while (i < numFading) {
+    uint16_t pixel = fadingPixels[i];
+    uint16_t progress = fadeProgress[pixel] + FADE_STEP;
+    if (progress >= FADE_DONE) {
+      progress = FADE_DONE;
+    }
+    if (fadedLayer[pixel] != baseLayer[pixel]) {
+      nblend(fadedLayer[pixel], baseLayer[pixel], progress);
+      markRow(pixel / DISPLAY_WIDTH);
     }
+    fadeProgress[pixel] = progress;
 
-  WLOG(201);
-    nblend(leds, targetLEDs, NUM_LEDS, blendPoint);
-  WLOG(202);
+    if (progress == FADE_DONE) {
+      // swap the last entry into this slot and look at it next
+      fadingPixels[i] = fadingPixels[--numFading];
+    } else {
+      i++;
+    }
   }
   WLOG(203);
 }
 
 void LEDAbstraction::setBrightness(uint8_t b)
 {
+  if (b == brightness)
+    return;
+  brightness = b;
   FastLED.setBrightness(b);
+  dirty = true;
 }
 
-void LEDAbstraction::stepColorWheel()
+void LEDAbstraction::setOutgoing(const CRGB *frame, const uint8_t *cover)
 {
-  static uint8_t counter = 0;
-  counter++;
-  if (counter == 0) counter++; // skip black
-  CRGB newColor = CHSV(counter,255,255);
+  outgoing = frame;
+  outgoingCover = cover;
+  markAllRows();
+}
 
-  for (int i=0; i<NUM_LEDS; i++) {
-    if (isFadeMode) {
-      if (targetLEDs[i].raw[0] != 0 || targetLEDs[i].raw[1] != 0 || targetLEDs[i].raw[2] != 0)
-	targetLEDs[i] = newColor;
-    } else {
-      if (leds[i].raw[0] != 0 || leds[i].raw[1] != 0 || leds[i].raw[2] != 0)
-	leds[i] = newColor;
+void LEDAbstraction::outgoingChanged()
+{
+  markAllRows();
+}
+
+void LEDAbstraction::setEffect(uint8_t e)
+{
+  if (e == effect)
+    return;
+  effect = e;
+  markAllRows();
+}
+
+// Moves the effect along a frame; the next Update() shows it
+void LEDAbstraction::stepEffect()
+{
+  if (effect == EFFECT_COLORWHEEL) {
+    effectHue++;
+    markAllRows();
+  }
+}
+
+void LEDAbstraction::setEffectLevel(uint8_t l)
+{
+  if (l == effectLevel)
+    return;
+  effectLevel = l;
+  markAllRows();
+}
+
+bool LEDAbstraction::setOverlay(uint8_t x, uint8_t y, CRGB color)
+{
+  if (x >= DISPLAY_WIDTH || y >= DISPLAY_HEIGHT)
+    return false;
+
+  uint8_t i;
+  for (i=0; i<numOverlay; i++) {
+    if (overlay[i].x == x && overlay[i].y == y)
+      break;
+  }
+  if (i == numOverlay) {
+    if (numOverlay == OVERLAY_PIXELS)
+      return false;
+    numOverlay++;
+    overlay[i].x = x;
+    overlay[i].y = y;
+  }
+  overlay[i].color = color;
+  markRow(y);
+  return true;
+}
+
+void LEDAbstraction::clearOverlay(uint8_t x, uint8_t y)
+{
+  for (uint8_t i=0; i<numOverlay; i++) {
+    if (overlay[i].x == x && overlay[i].y == y) {
+      overlay[i] = overlay[--numOverlay];
+      markRow(y);
+      return;
     }
   }
-  FastLED.show();
 }
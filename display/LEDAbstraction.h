@@ -3,10 +3,42 @@
 
 #define FASTLED_ALLOW_INTERRUPTS 0
 #include <FastLED.h>
+#include "PanelGeometry.h"
 
-#define NUM_COLS 32
-#define NUM_ROWS 8
-#define NUM_LEDS (NUM_ROWS * NUM_COLS)
+// Text scrolls along the length of the display, so its "rows" run
+// across the width
+#define NUM_COLS DISPLAY_HEIGHT
+#define NUM_ROWS DISPLAY_WIDTH
+
+// Drawing goes to the base layer, in display order. Update() fades it,
+// lays any outgoing frame from a transition over it, applies the effect
+// layer and then the overlay, and composites the rows that changed into
+// leds[] (in chain order) for FastLED. Effects, transitions and overlays
+// never touch the base layer, so a mode can always read back what it
+// drew.
+
+// The output buffer (with its spare offscreen LED), the base and faded
+// layers and the fader's per-pixel state
+#define LED_BUFFER_BYTES (sizeof(CRGB) * (NUM_LEDS + 1) + \
+			  (2 * sizeof(CRGB) + sizeof(uint8_t) + sizeof(uint16_t)) * DISPLAY_PIXELS)
+
+// Each fading pixel moves FADE_STEP/255ths of the way to its target per
+// Update(), and lands on it exactly once its progress reaches FADE_DONE
+#define FADE_STEP 75
+#define FADE_DONE 255
+
+// Effect layer
+#define EFFECT_NONE       0
+#define EFFECT_COLORWHEEL 1 // every lit pixel takes the same cycling hue
+
+// Overlay: a few pixels drawn over everything else
+#define OVERLAY_PIXELS 8
+
+typedef struct _overlayPixel {
+  uint8_t x;
+  uint8_t y;
+  CRGB color;
+} overlayPixel;
 
 class LEDAbstraction {
  public:
@@ -14,25 +46,84 @@ class LEDAbstraction {
   ~LEDAbstraction();
 
   void Init();
-  void Update();
+  void Update(); // fade, composite and show, once per frame
 
+  // Base layer
   CRGB GetLED(uint8_t x, uint8_t y);
   void SetLED(uint8_t x, uint8_t y, CRGB color);
 
   void setFadeMode(bool f);
+  bool fadeMode();
   void stepFader();
+  uint16_t fadingCount();
 
-  void clear(bool suppressRedraw = false);
-  void clearByScrolling();
+  void clear();
 
   void setBrightness(uint8_t b);
 
-  void stepColorWheel();
+  // Effect layer
+  void setEffect(uint8_t e);
+  void stepEffect();
+  void setEffectLevel(uint8_t l); // scales the base layer; 255 is full
+
+  // Outgoing layer: while a transition runs, the frame on its way out
+  // sits over the base layer. cover[] says how much of each of its
+  // pixels still shows: 255 is all of it, 0 shows the base layer.
+  void setOutgoing(const CRGB *frame, const uint8_t *cover); // NULLs when it's done
+  void outgoingChanged(); // composite every row again
+
+  // Overlay
+  bool setOverlay(uint8_t x, uint8_t y, CRGB color); // false if no room
+  void clearOverlay(uint8_t x, uint8_t y);
+
+  uint32_t lastShowMicros();
+  uint32_t showCount();
+  uint32_t skippedShowCount();
+  uint16_t showsPerSecond();
 
  private:
-  CRGB leds[NUM_LEDS]; // actual current state
-  CRGB targetLEDs[NUM_LEDS]; // expected final state
-  uint16_t blendPoint;
+  void show();
+  void showIfChanged();
+  void setPixel(uint16_t pixel, CRGB color);
+  void finishFades();
+  void composite();
+  void markRow(uint8_t y);
+  void markAllRows();
+
+  // leds[] is the output, handed to FastLED. baseLayer[] always holds
+  // the finished frame; fadedLayer[] matches it except at the pixels
+  // in fadingPixels[].
+  CRGB leds[NUM_LEDS + 1];
+  CRGB baseLayer[DISPLAY_PIXELS];
+  CRGB fadedLayer[DISPLAY_PIXELS];
+  uint8_t fadeProgress[DISPLAY_PIXELS]; // FADE_DONE unless in fadingPixels[]
+  uint16_t fadingPixels[DISPLAY_PIXELS];
+  uint16_t numFading;
+
+  uint8_t effect;
+  uint8_t effectHue;
+  uint8_t effectLevel;
+
+  const CRGB *outgoing;
+  const uint8_t *outgoingCover;
+
+  overlayPixel overlay[OVERLAY_PIXELS];
+  uint8_t numOverlay;
+
+  // Display rows that need compositing again
+  uint8_t dirtyRows[(DISPLAY_HEIGHT + 7) / 8];
+  bool anyRowDirty;
+
+  uint32_t showMicros;
+  uint8_t brightness;
+
+  // Set whenever leds[] or the brightness differ from what is on the panel
+  bool dirty;
+  uint32_t shows;
+  uint32_t skippedShows;
+  uint32_t rateWindowStart;
+  uint16_t rateWindowShows;
+  uint16_t lastShowRate;
   
   bool isFadeMode;
 };
@@ -0,0 +1,75 @@
+#include "Palette.h"
+
+CRGB palette[PAL_SIZE];
+static uint8_t currentTheme = NUMTHEMES;
+
+// Each theme is a list of (hue, saturation, value) triples, in palette
+// order
+static const uint8_t themes[NUMTHEMES][PAL_SIZE][3] PROGMEM = {
+  { // THEME_CLASSIC
+    { 0, 0, 0 },                 // empty
+    { 0, 0, 255 },               // I
+    { HUE_ORANGE, 255, 255 },    // O
+    { HUE_YELLOW, 255, 255 },    // S
+    { HUE_AQUA, 255, 255 },      // Z
+    { HUE_BLUE, 255, 255 },      // L
+    { HUE_PURPLE, 255, 255 },    // J
+    { HUE_PINK, 255, 255 },      // T
+    { HUE_GREEN, 255, 255 },     // snake
+    { HUE_BLUE, 255, 255 },      // food
+    { HUE_GREEN, 255, 255 },     // clock
+    { HUE_RED, 255, 255 },       // menu selection
+    { 0, 0, 255 },               // line flash
+    { 0, 0, 255 },               // text
+  },
+  { // THEME_PASTEL
+    { 0, 0, 0 },
+    { 0, 0, 200 },
+    { HUE_ORANGE, 120, 255 },
+    { HUE_YELLOW, 120, 255 },
+    { HUE_AQUA, 120, 255 },
+    { HUE_BLUE, 120, 255 },
+    { HUE_PURPLE, 120, 255 },
+    { HUE_PINK, 120, 255 },
+    { HUE_GREEN, 120, 255 },
+    { HUE_PINK, 120, 255 },
+    { HUE_AQUA, 120, 255 },
+    { HUE_PINK, 160, 255 },
+    { 0, 0, 200 },
+    { 0, 0, 255 },
+  },
+  { // THEME_MONO
+    { 0, 0, 0 },
+    { HUE_GREEN, 255, 255 },
+    { HUE_GREEN, 255, 200 },
+    { HUE_GREEN, 255, 150 },
+    { HUE_GREEN, 255, 255 },
+    { HUE_GREEN, 255, 200 },
+    { HUE_GREEN, 255, 150 },
+    { HUE_GREEN, 255, 255 },
+    { HUE_GREEN, 255, 200 },
+    { HUE_GREEN, 120, 255 },
+    { HUE_GREEN, 255, 255 },
+    { HUE_GREEN, 120, 255 },
+    { HUE_GREEN, 60, 255 },
+    { HUE_GREEN, 120, 255 },
+  },
+};
+
+void setPaletteTheme(uint8_t theme)
+{
+  if (theme >= NUMTHEMES)
+    theme = THEME_CLASSIC;
+  currentTheme = theme;
+
+  for (uint8_t i=0; i<PAL_SIZE; i++) {
+    palette[i] = CHSV(pgm_read_byte(&themes[theme][i][0]),
+		      pgm_read_byte(&themes[theme][i][1]),
+		      pgm_read_byte(&themes[theme][i][2]));
+  }
+}
+
+uint8_t paletteTheme()
+{
+  return currentTheme;
+}
@@ -0,0 +1,43 @@
+#ifndef __PALETTE_H
+#define __PALETTE_H
+
+#include "LEDAbstraction.h"
+#include "tetris.h"
+
+// Everything that draws game pieces looks its colors up here, by index,
+// instead of building a CHSV per pixel. The table is rebuilt only when
+// the theme changes.
+//
+// The first entries line up with the engines' square indices (see
+// GetSquareIndex()), so a board square is its own palette index.
+enum {
+  PAL_EMPTY  = SQUARE_EMPTY,
+  PAL_I      = SQUARE_PIECE(0),
+  PAL_O      = SQUARE_PIECE(1),
+  PAL_S      = SQUARE_PIECE(2),
+  PAL_Z      = SQUARE_PIECE(3),
+  PAL_L      = SQUARE_PIECE(4),
+  PAL_J      = SQUARE_PIECE(5),
+  PAL_T      = SQUARE_PIECE(6),
+  PAL_SNAKE  = SQUARE_SNAKE,
+  PAL_FOOD   = SQUARE_FOOD,
+  PAL_CLOCK,       // the pieces that make up the clock face
+  PAL_SELECTION,   // the box around the selected menu item
+  PAL_FLASH,       // completed lines, while they flash
+  PAL_TEXT,        // scrolling text, unless it asks for a color
+  PAL_SIZE
+};
+
+enum {
+  THEME_CLASSIC = 0,
+  THEME_PASTEL  = 1,
+  THEME_MONO    = 2,
+  NUMTHEMES
+};
+
+extern CRGB palette[PAL_SIZE];
+
+void setPaletteTheme(uint8_t theme);
+uint8_t paletteTheme();
+
+#endif
@@ -0,0 +1,16 @@
+#include "PanelGeometry.h"
+
+// The original hard-wired mapping, for a single unrotated panel
+static_assert(panelPixelIndex(0, 0, 8, 32, 0, SERPENTINE_EVEN_REVERSED) == 7 &&
+	      panelPixelIndex(7, 0, 8, 32, 0, SERPENTINE_EVEN_REVERSED) == 0 &&
+	      panelPixelIndex(0, 1, 8, 32, 0, SERPENTINE_EVEN_REVERSED) == 8 &&
+	      panelPixelIndex(3, 30, 8, 32, 0, SERPENTINE_EVEN_REVERSED) == 8*31-3-1,
+	      "panel mapping doesn't match the serpentine wiring");
+
+template<uint16_t... I>
+constexpr panelMap buildPanelMap(indexSeq<I...>)
+{
+  return { { displayPixelIndex(I % DISPLAY_WIDTH, I / DISPLAY_WIDTH)... } };
+}
+
+const panelMap panelLUT PROGMEM = buildPanelMap(makeIndexSeq<DISPLAY_PIXELS>::type());
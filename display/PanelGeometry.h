@@ -0,0 +1,164 @@
+#ifndef __PANELGEOMETRY_H
+#define __PANELGEOMETRY_H
+
+#include <Arduino.h>
+#include "IndexSequence.h"
+
+// How the LED panels are wired, and how they're arranged to make up
+// the display. Everything that draws goes through panelIndex(), which
+// looks the position on the LED chain up in a table in flash that's
+// built at compile time from these settings. Any of them can be
+// overridden from the build.
+//
+// Each panel's strip snakes back and forth along rows of PANEL_WIDTH
+// pixels; PANEL_SERPENTINE says which rows run backwards.
+#define SERPENTINE_EVEN_REVERSED 0 // rows 0, 2, 4... run right to left
+#define SERPENTINE_ODD_REVERSED  1
+#define SERPENTINE_NONE          2 // every row runs left to right
+
+#ifndef PANEL_WIDTH
+#define PANEL_WIDTH 8 // pixels across, as wired
+#endif
+#ifndef PANEL_HEIGHT
+#define PANEL_HEIGHT 32
+#endif
+#ifndef PANEL_ROTATION
+#define PANEL_ROTATION 0 // quarter turns clockwise, for a single panel
+#endif
+#ifndef PANEL_SERPENTINE
+#define PANEL_SERPENTINE SERPENTINE_EVEN_REVERSED
+#endif
+
+#define PANEL_PIXELS (PANEL_WIDTH * PANEL_HEIGHT)
+
+// The display is one or more panels (tiles) chained together, in the
+// order they're listed. Each tile is placed on the display with its
+// top left corner at (originX, originY), turned some number of
+// quarter turns clockwise from how it's wired.
+typedef struct _panelTile {
+  uint8_t originX;
+  uint8_t originY;
+  uint8_t rotation;
+} panelTile;
+
+#define LAYOUT_SINGLE 0 // one panel, 8x32
+#define LAYOUT_16X32  1 // two panels side by side, the second upside down
+#define LAYOUT_32X32  2 // four panels side by side, alternately upside down
+#define LAYOUT_32X16  3 // two panels on their sides, one above the other
+
+#ifndef PANEL_LAYOUT
+#define PANEL_LAYOUT LAYOUT_SINGLE
+#endif
+
+#if PANEL_LAYOUT == LAYOUT_SINGLE
+#define PANEL_TILE_COUNT 1
+#define PANEL_TILES { { 0, 0, PANEL_ROTATION } }
+#define DISPLAY_WIDTH ((PANEL_ROTATION & 1) ? PANEL_HEIGHT : PANEL_WIDTH)
+#define DISPLAY_HEIGHT ((PANEL_ROTATION & 1) ? PANEL_WIDTH : PANEL_HEIGHT)
+#elif PANEL_LAYOUT == LAYOUT_16X32
+#define PANEL_TILE_COUNT 2
+#define PANEL_TILES { { 0, 0, 0 }, { 8, 0, 2 } }
+#define DISPLAY_WIDTH 16
+#define DISPLAY_HEIGHT 32
+#elif PANEL_LAYOUT == LAYOUT_32X32
+#define PANEL_TILE_COUNT 4
+#define PANEL_TILES { { 0, 0, 0 }, { 8, 0, 2 }, { 16, 0, 0 }, { 24, 0, 2 } }
+#define DISPLAY_WIDTH 32
+#define DISPLAY_HEIGHT 32
+#elif PANEL_LAYOUT == LAYOUT_32X16
+#define PANEL_TILE_COUNT 2
+#define PANEL_TILES { { 0, 0, 1 }, { 0, 8, 1 } }
+#define DISPLAY_WIDTH 32
+#define DISPLAY_HEIGHT 16
+#else
+#error Unknown PANEL_LAYOUT
+#endif
+
+#define DISPLAY_PIXELS (DISPLAY_WIDTH * DISPLAY_HEIGHT)
+
+// The whole chain. Anything on the display that no tile covers goes to
+// one spare LED past the end, which is never shown.
+#define NUM_LEDS (PANEL_TILE_COUNT * PANEL_PIXELS)
+#define PANEL_OFFSCREEN NUM_LEDS
+
+// A WS2812 takes 30us per LED (24 bits at 800kHz), plus a 50us latch
+#define PANEL_SHOW_MICROS (NUM_LEDS * 30UL + 50)
+
+constexpr panelTile panelTiles[PANEL_TILE_COUNT] = PANEL_TILES;
+
+static_assert(DISPLAY_PIXELS <= 65535 && NUM_LEDS < 65535,
+	      "chain positions are stored in a uint16_t");
+
+// Chain position of (px, py) on an unrotated panel with rows of stride
+// pixels
+constexpr uint16_t serpentineIndex(uint8_t px, uint8_t py, uint8_t stride,
+				   uint8_t serpentine)
+{
+  return py * stride +
+    (((serpentine == SERPENTINE_EVEN_REVERSED && !(py & 1)) ||
+      (serpentine == SERPENTINE_ODD_REVERSED && (py & 1))) ?
+     (stride - 1 - px) : px);
+}
+
+// Chain position of (x, y) on a w x h (as mounted) panel
+constexpr uint16_t panelPixelIndex(uint8_t x, uint8_t y, uint8_t w, uint8_t h,
+				   uint8_t rotation, uint8_t serpentine)
+{
+  return
+    (rotation == 0) ? serpentineIndex(x, y, w, serpentine) :
+    (rotation == 1) ? serpentineIndex(h - 1 - y, x, h, serpentine) :
+    (rotation == 2) ? serpentineIndex(w - 1 - x, h - 1 - y, w, serpentine) :
+    serpentineIndex(y, w - 1 - x, h, serpentine);
+}
+
+constexpr uint8_t tileWidth(uint8_t rotation)
+{
+  return (rotation & 1) ? PANEL_HEIGHT : PANEL_WIDTH;
+}
+
+constexpr uint8_t tileHeight(uint8_t rotation)
+{
+  return (rotation & 1) ? PANEL_WIDTH : PANEL_HEIGHT;
+}
+
+constexpr bool tileContains(uint8_t t, uint8_t x, uint8_t y)
+{
+  return (x >= panelTiles[t].originX &&
+	  x < panelTiles[t].originX + tileWidth(panelTiles[t].rotation) &&
+	  y >= panelTiles[t].originY &&
+	  y < panelTiles[t].originY + tileHeight(panelTiles[t].rotation));
+}
+
+// Which tile (x, y) is on, or PANEL_TILE_COUNT if none
+constexpr uint8_t tileAt(uint8_t x, uint8_t y, uint8_t t = 0)
+{
+  return (t >= PANEL_TILE_COUNT || tileContains(t, x, y)) ? t : tileAt(x, y, t + 1);
+}
+
+constexpr uint16_t tilePixelIndex(uint8_t x, uint8_t y, uint8_t t)
+{
+  return (t >= PANEL_TILE_COUNT) ? PANEL_OFFSCREEN :
+    t * PANEL_PIXELS +
+    panelPixelIndex(x - panelTiles[t].originX, y - panelTiles[t].originY,
+		    tileWidth(panelTiles[t].rotation),
+		    tileHeight(panelTiles[t].rotation),
+		    panelTiles[t].rotation, PANEL_SERPENTINE);
+}
+
+constexpr uint16_t displayPixelIndex(uint8_t x, uint8_t y)
+{
+  return tilePixelIndex(x, y, tileAt(x, y));
+}
+
+typedef struct _panelMap {
+  uint16_t index[DISPLAY_PIXELS];
+} panelMap;
+
+extern const panelMap panelLUT;
+
+static inline uint16_t panelIndex(uint8_t x, uint8_t y)
+{
+  return pgm_read_word(&panelLUT.index[y * DISPLAY_WIDTH + x]);
+}
+
+#endif
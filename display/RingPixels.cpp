@@ -1,59 +1,89 @@
 #include "RingPixels.h"
 
-RingPixels::RingPixels(int width, int length)
-{
-  this->buffer = (byte *)malloc(length*width);
-  this->max = length;
-  this->width = width;
-}
+static_assert((RINGPIXELS_COLUMNS & (RINGPIXELS_COLUMNS - 1)) == 0,
+	      "RINGPIXELS_COLUMNS must be a power of two");
+static_assert((RINGPIXELS_RUNS & (RINGPIXELS_RUNS - 1)) == 0,
+	      "RINGPIXELS_RUNS must be a power of two");
+static_assert(RINGPIXELS_RUNS < 256, "runs are counted in a uint8_t");
 
-RingPixels::~RingPixels()
+RingPixels::RingPixels(uint8_t color)
 {
-  free (this->buffer);
+  defaultColor = color;
+  clear();
 }
 
-bool RingPixels::isFull()
+void RingPixels::clear()
 {
-  return (this->max == this->fill);
+  head = 0;
+  fill = 0;
+  runHead = 0;
+  runCount = 1;
+  runs[0].start = 0;
+  runs[0].color = defaultColor;
 }
 
-void RingPixels::clear()
+bool RingPixels::isFull()
 {
-  this->fill = 0;
+  return fill == RINGPIXELS_COLUMNS;
 }
 
 bool RingPixels::hasData()
 {
-  return (this->fill != 0);
+  return fill != 0;
 }
 
-int RingPixels::freeSpace()
+uint16_t RingPixels::freeSpace()
 {
-  return (this->max - this->fill);
+  return RINGPIXELS_COLUMNS - fill;
 }
 
-bool RingPixels::addLine(byte *b)
+bool RingPixels::addColumn(uint8_t bits)
 {
-  if (this->max == this->fill)
+  if (fill == RINGPIXELS_COLUMNS)
     return false;
 
-  int idx = (this->ptr + this->fill) % this->max;
-  for (int i=0; i<this->width; i++) {
-    this->buffer[idx*this->width+i] = b[i];
+  columns[(head + fill) & (RINGPIXELS_COLUMNS - 1)] = bits;
+  fill++;
+  return true;
+}
+
+bool RingPixels::setColor(uint8_t color)
+{
+  uint16_t at = head + fill;
+  colorRun *last = &runs[(runHead + runCount - 1) & (RINGPIXELS_RUNS - 1)];
+  if (last->color == color)
+    return true;
+  if (last->start == at || fill == 0) {
+    // Nothing's been added in the current color, so just change it
+    last->start = at;
+    last->color = color;
+    return true;
   }
+  if (runCount == RINGPIXELS_RUNS)
+    return false;
 
-  this->fill++;
+  colorRun *r = &runs[(runHead + runCount) & (RINGPIXELS_RUNS - 1)];
+  r->start = at;
+  r->color = color;
+  runCount++;
   return true;
 }
 
-byte *RingPixels::consumeLine()
+bool RingPixels::consumeColumn(uint8_t *bits, uint8_t *color)
 {
-  if (this->fill == 0)
-    return 0;
-  
-  byte *ret = &this->buffer[this->ptr * this->width];
-  this->fill--;
-  this->ptr++;
-  this->ptr %= this->max;
-  return ret;
+  if (fill == 0)
+    return false;
+
+  // Move on to the next run once head reaches it
+  while (runCount > 1 &&
+	 runs[(runHead + 1) & (RINGPIXELS_RUNS - 1)].start == head) {
+    runHead = (runHead + 1) & (RINGPIXELS_RUNS - 1);
+    runCount--;
+  }
+
+  *bits = columns[head & (RINGPIXELS_COLUMNS - 1)];
+  *color = runs[runHead].color;
+  head++;
+  fill--;
+  return true;
 }
@@ -1,24 +1,45 @@
+#ifndef __RINGPIXELS_H
+#define __RINGPIXELS_H
+
 #include <Arduino.h>
+#include <stdint.h>
+
+// Rendered text waiting to scroll on: one byte per column of a glyph
+// (bit y is glyph row y), in a fixed ring. Columns can carry a color,
+// as runs: setColor() applies to every column added after it, until the
+// next setColor().
 
-typedef unsigned char byte;
+#define RINGPIXELS_COLUMNS 256 // must be a power of two; eight 32-row screens
+#define RINGPIXELS_RUNS 16 // color changes in flight; also a power of two
+
+typedef struct _colorRun {
+  uint16_t start; // column number the run starts at
+  uint8_t color; // palette index
+} colorRun;
 
 class RingPixels {
  public:
-  RingPixels(int width, int length);
-  ~RingPixels();
+  RingPixels(uint8_t color);
 
   void clear();
 
   bool isFull();
   bool hasData();
-  int freeSpace();
-  bool addLine(byte *l);
-  byte *consumeLine();
-  
+  uint16_t freeSpace();
+
+  bool addColumn(uint8_t bits);
+  bool setColor(uint8_t color); // false if too many runs are waiting
+  bool consumeColumn(uint8_t *bits, uint8_t *color);
+
  private:
-  byte *buffer;
-  int max;
-  int width;
-  int ptr;
-  int fill;
+  uint8_t columns[RINGPIXELS_COLUMNS];
+  uint16_t head; // column number of the next to consume; wraps freely
+  uint16_t fill;
+
+  colorRun runs[RINGPIXELS_RUNS];
+  uint8_t runHead; // the run that head is in
+  uint8_t runCount;
+  uint8_t defaultColor;
 };
+
+#endif
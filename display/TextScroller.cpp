@@ -0,0 +1,150 @@
+#include "TextScroller.h"
+
+TextScroller::TextScroller(LEDAbstraction *p) :
+  backingText(BACKINGTEXTSIZE),
+  backingPixels(PAL_TEXT)
+{
+  panel = p;
+  dropped = 0;
+  clear();
+}
+
+static_assert((VIEW_COLUMNS & (VIEW_COLUMNS - 1)) == 0,
+	      "VIEW_COLUMNS must be a power of two");
+static_assert(VIEW_COLUMNS >= DISPLAY_HEIGHT, "VIEW_COLUMNS must cover the display");
+static_assert(VIEW_COLUMNS <= 256, "viewStart is a uint8_t");
+
+void TextScroller::clear()
+{
+  backingText.clear();
+  backingPixels.clear();
+  decoder.reset();
+  lastCodepoint = 0;
+  memset(viewColumns, 0, sizeof(viewColumns));
+  memset(viewColors, PAL_TEXT, sizeof(viewColors));
+  viewStart = 0;
+  viewMoved = true;
+}
+
+bool TextScroller::addChar(char c)
+{
+  if (backingText.isFull()) {
+    dropped++;
+    return false;
+  }
+  backingText.addByte(c);
+  fillBackingPixels();
+  return true;
+}
+
+// Text only waits in backingText once backingPixels is full, and the
+// color has to apply from the right column on
+bool TextScroller::addColor(uint8_t color)
+{
+  fillBackingPixels();
+  if (color >= PAL_SIZE || backingText.hasData())
+    return false;
+  return backingPixels.setColor(color);
+}
+
+// Render everything there's room for; one byte can finish two code
+// points, if it cut the one before it short
+void TextScroller::fillBackingPixels()
+{
+  while (backingText.hasData() && backingPixels.freeSpace() >= 2 * TEXT_GLYPH_COLUMNS) {
+    uint16_t codepoints[2];
+    uint8_t n = decoder.decode(backingText.consumeByte(), codepoints);
+    for (uint8_t i=0; i<n; i++) {
+      addGlyphToBackingStore(codepoints[i]);
+    }
+  }
+}
+
+bool TextScroller::hasData()
+{
+  return backingText.hasData() || backingPixels.hasData();
+}
+
+bool TextScroller::step()
+{
+  // What comes on at the bottom of the display replaces what just went
+  // off the top; once the text runs out, blank columns keep it moving
+  uint8_t slot = (viewStart + DISPLAY_HEIGHT) & (VIEW_COLUMNS - 1);
+  bool scrolled = backingPixels.consumeColumn(&viewColumns[slot], &viewColors[slot]);
+  if (!scrolled) {
+    viewColumns[slot] = 0;
+  }
+  viewStart = (viewStart + 1) & (VIEW_COLUMNS - 1);
+  viewMoved = true;
+
+  fillBackingPixels();
+
+  return scrolled;
+}
+
+// Slice bit b lands on panel x = NUM_ROWS-1-b, as it always has,
+// whichever way round the glyphs are
+void TextScroller::draw()
+{
+  if (!viewMoved)
+    return;
+  viewMoved = false;
+
+  CRGB black = CRGB::Black;
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    uint8_t slot = (viewStart + y) & (VIEW_COLUMNS - 1);
+    uint8_t column = viewColumns[slot];
+    CRGB color = palette[viewColors[slot]];
+    for (int x=0; x<NUM_ROWS; x++) {
+      int bit = NUM_ROWS-1-x;
+      bool lit = bit < 8 && (column & (1 << bit));
+      panel->SetLED(x, y, lit ? color : black);
+    }
+  }
+}
+
+void TextScroller::redraw()
+{
+  viewMoved = true;
+}
+
+uint32_t TextScroller::droppedBytes()
+{
+  return dropped;
+}
+
+uint32_t TextScroller::glyphHits()
+{
+  return glyphs.hits();
+}
+
+uint32_t TextScroller::glyphMisses()
+{
+  return glyphs.misses();
+}
+
+void TextScroller::setOrientation(uint8_t o)
+{
+  glyphs.setOrientation(o);
+  clear();
+}
+
+uint8_t TextScroller::orientation()
+{
+  return glyphs.orientation();
+}
+
+// The space goes before the glyph, since that's when the pair is known;
+// kerning only applies side by side
+void TextScroller::addGlyphToBackingStore(uint16_t codepoint)
+{
+  const glyphSlices *g = glyphs.lookup(codepoint);
+  if (lastCodepoint &&
+      (glyphs.orientation() == FONT_UPRIGHT || !kernedPair(lastCodepoint, codepoint))) {
+    backingPixels.addColumn(0);
+  }
+  for (uint8_t i=0; i<g->count; i++) {
+    backingPixels.addColumn(g->slices[i]);
+  }
+  lastCodepoint = codepoint;
+}
@@ -0,0 +1,76 @@
+#ifndef __TEXTSCROLLER_H
+#define __TEXTSCROLLER_H
+
+#include <stdint.h>
+#include <RingBuffer.h>
+#include "LEDAbstraction.h"
+#include "RingPixels.h"
+#include "GlyphTable.h"
+#include "GlyphCache.h"
+#include "Utf8Decoder.h"
+#include "Palette.h"
+
+// Scrolling text for text and startup mode. Text comes in as UTF-8 and
+// is drawn in the proportional font from GlyphTable. Characters are rendered to
+// columns of pixels in backingPixels as they arrive; they only wait in
+// backingText if that's full. What's on the display is a window on a ring of
+// columns: step() moves the window along by one column, which is just a
+// pointer bump plus one column fed in from backingPixels, and draw()
+// copies the window to the panel once per frame. So the scroll speed
+// doesn't change what each step costs.
+
+// Offscreen text buffering; bytes, so an accented letter takes two
+#define BACKINGTEXTSIZE 256
+
+// The most a glyph can add to backingPixels: its slices plus the space
+#define TEXT_GLYPH_COLUMNS (FONT_MAX_SLICES + 1)
+
+// Default time between steps; /text can change it
+#define TEXT_SCROLL_MILLIS 100
+
+// The visible window; must be a power of two, and at least DISPLAY_HEIGHT
+#define VIEW_COLUMNS 64
+
+class TextScroller {
+ public:
+  TextScroller(LEDAbstraction *p);
+
+  void clear();
+
+  bool addChar(char c); // one byte of UTF-8; false if it was dropped
+  bool addColor(uint8_t color); // palette index for the text added after it; false if text is still waiting for room
+  bool hasData(); // anything left to scroll on
+
+  bool step(); // false if there was nothing to scroll on
+  void draw(); // copies the window to the panel if it has moved
+  void redraw(); // draw() again even if it hasn't (the panel was used for something else)
+
+  void setOrientation(uint8_t o); // FONT_SIDEWAYS or FONT_UPRIGHT; starts over with no text
+  uint8_t orientation();
+
+  uint32_t droppedBytes(); // added while backingText was full
+  uint32_t glyphHits();
+  uint32_t glyphMisses();
+
+ private:
+  void fillBackingPixels();
+  void addGlyphToBackingStore(uint16_t codepoint);
+
+  LEDAbstraction *panel;
+  RingBuffer backingText;
+  RingPixels backingPixels;
+  Utf8Decoder decoder;
+  GlyphCache glyphs;
+  uint16_t lastCodepoint; // 0 at the start, where no space is needed
+  uint32_t dropped;
+
+  // One slice of a glyph (see GlyphTable.h), and its palette index, per
+  // display row; the window starts at viewStart, which is drawn at
+  // display row 0
+  uint8_t viewColumns[VIEW_COLUMNS];
+  uint8_t viewColors[VIEW_COLUMNS];
+  uint8_t viewStart;
+  bool viewMoved;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "Transition.h"
+
+// Dissolve visits pixel (k * DISSOLVE_STRIDE) % DISPLAY_PIXELS for each
+// k in turn, which reaches every pixel exactly once as long as the
+// stride shares no factor with the pixel count
+#define DISSOLVE_STRIDE 97
+static_assert(DISPLAY_PIXELS % DISSOLVE_STRIDE != 0,
+	      "DISSOLVE_STRIDE must be coprime with DISPLAY_PIXELS");
+
+Transition::Transition(LEDAbstraction *p)
+{
+  panel = p;
+  currentKind = TRANSITION_NONE;
+  frame = 0;
+  finishedCount = 0;
+}
+
+void Transition::start(uint8_t kind, void (*then)())
+{
+  cancel();
+
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
+      outgoing[y * DISPLAY_WIDTH + x] = panel->GetLED(x, y);
+    }
+  }
+  memset(cover, 255, sizeof(cover));
+  panel->setOutgoing(outgoing, cover);
+
+  currentKind = kind;
+  frame = 0;
+
+  // Whatever it draws stays hidden until it's uncovered
+  if (then) {
+    then();
+  }
+}
+
+void Transition::cancel()
+{
+  if (currentKind != TRANSITION_NONE) {
+    panel->setOutgoing(NULL, NULL);
+  }
+  currentKind = TRANSITION_NONE;
+}
+
+bool Transition::active()
+{
+  return currentKind != TRANSITION_NONE;
+}
+
+uint8_t Transition::kind()
+{
+  return currentKind;
+}
+
+uint16_t Transition::frames()
+{
+  switch (currentKind) {
+  case TRANSITION_SCROLL:
+  case TRANSITION_WIPE:
+    return (DISPLAY_HEIGHT + TRANSITION_ROWS_PER_FRAME - 1) / TRANSITION_ROWS_PER_FRAME;
+  case TRANSITION_DISSOLVE:
+    return DISSOLVE_FRAMES;
+  case TRANSITION_FADE:
+    return TRANSITION_FADE_FRAMES;
+  }
+  return 0;
+}
+
+uint32_t Transition::finished()
+{
+  return finishedCount;
+}
+
+bool Transition::step()
+{
+  switch (currentKind) {
+  case TRANSITION_SCROLL:
+    scrollFrame();
+    break;
+  case TRANSITION_WIPE:
+    wipeFrame();
+    break;
+  case TRANSITION_DISSOLVE:
+    dissolveFrame();
+    break;
+  case TRANSITION_FADE:
+    fadeFrame();
+    break;
+  default:
+    return false;
+  }
+  panel->outgoingChanged();
+
+  if (++frame < frames())
+    return false;
+
+  finish();
+  return true;
+}
+
+void Transition::finish()
+{
+  panel->setOutgoing(NULL, NULL);
+  currentKind = TRANSITION_NONE;
+  finishedCount++;
+}
+
+void Transition::uncoverRow(uint8_t y)
+{
+  memset(&cover[y * DISPLAY_WIDTH], 0, DISPLAY_WIDTH);
+}
+
+// The old frame moves down, cover and all, and the rows it leaves at
+// the top show the new one
+void Transition::scrollFrame()
+{
+  uint16_t shift = TRANSITION_ROWS_PER_FRAME * DISPLAY_WIDTH;
+  memmove(&outgoing[shift], outgoing, (DISPLAY_PIXELS - shift) * sizeof(CRGB));
+  memmove(&cover[shift], cover, DISPLAY_PIXELS - shift);
+  for (uint8_t y=0; y<TRANSITION_ROWS_PER_FRAME; y++) {
+    uncoverRow(y);
+  }
+}
+
+void Transition::wipeFrame()
+{
+  for (uint8_t i=0; i<TRANSITION_ROWS_PER_FRAME; i++) {
+    uint16_t y = frame * TRANSITION_ROWS_PER_FRAME + i;
+    if (y < DISPLAY_HEIGHT)
+      uncoverRow(y);
+  }
+}
+
+void Transition::dissolveFrame()
+{
+  uint32_t from = (uint32_t) DISPLAY_PIXELS * frame / DISSOLVE_FRAMES;
+  uint32_t to = (uint32_t) DISPLAY_PIXELS * (frame + 1) / DISSOLVE_FRAMES;
+  for (uint32_t k=from; k<to; k++) {
+    cover[(k * DISSOLVE_STRIDE) % DISPLAY_PIXELS] = 0;
+  }
+}
+
+void Transition::fadeFrame()
+{
+  memset(cover, 255 - 255 * (frame + 1) / TRANSITION_FADE_FRAMES, sizeof(cover));
+}
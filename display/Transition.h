@@ -0,0 +1,58 @@
+#ifndef __TRANSITION_H
+#define __TRANSITION_H
+
+#include <stdint.h>
+#include "LEDAbstraction.h"
+
+// Takes the panel from one mode to the next a frame at a time instead
+// of in one blocking loop. start() copies what's on the panel into the
+// outgoing layer, then calls whatever it was passed (normally the mode
+// that's taking over). That mode draws into the base layer underneath
+// as it normally would, and each step() uncovers a little more of it.
+// step() only changes the layer; loop()'s once-per-frame Update() shows
+// it, so loop() calls step() no more often than TRANSITION_FRAME_MILLIS.
+
+#define TRANSITION_NONE     0
+#define TRANSITION_SCROLL   1 // the old frame slides off the far end
+#define TRANSITION_WIPE     2 // the old frame goes a row at a time
+#define TRANSITION_DISSOLVE 3 // the old frame goes a pixel at a time, in a scattered order
+#define TRANSITION_FADE     4 // the old frame fades in to the new
+
+#define TRANSITION_FRAME_MILLIS 35 // the same as the panel refresh, so every frame is seen
+#define TRANSITION_ROWS_PER_FRAME 2 // scroll and wipe
+#define DISSOLVE_FRAMES 16
+#define TRANSITION_FADE_FRAMES 12
+
+class Transition {
+ public:
+  Transition(LEDAbstraction *p);
+
+  void start(uint8_t kind, void (*then)() = NULL);
+  void cancel(); // cuts straight to the new mode
+
+  bool step(); // true on the frame that finishes
+  bool active();
+  uint8_t kind();
+  uint16_t frames(); // how many step() takes for the current kind
+
+  uint32_t finished(); // since boot
+
+ private:
+  void scrollFrame();
+  void wipeFrame();
+  void dissolveFrame();
+  void fadeFrame();
+  void uncoverRow(uint8_t y);
+  void finish();
+
+  LEDAbstraction *panel;
+  uint8_t currentKind;
+  uint16_t frame;
+
+  CRGB outgoing[DISPLAY_PIXELS];
+  uint8_t cover[DISPLAY_PIXELS];
+
+  uint32_t finishedCount;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "Utf8Decoder.h"
+
+Utf8Decoder::Utf8Decoder()
+{
+  reset();
+}
+
+void Utf8Decoder::reset()
+{
+  codepoint = 0;
+  minimum = 0;
+  needed = 0;
+}
+
+uint8_t Utf8Decoder::decode(uint8_t b, uint16_t out[2])
+{
+  if (needed) {
+    if ((b & 0xc0) == 0x80) {
+      codepoint = (codepoint << 6) | (b & 0x3f);
+      if (--needed)
+	return 0;
+      bool bad = codepoint < minimum || codepoint > 0xffff ||
+	(codepoint >= 0xd800 && codepoint <= 0xdfff);
+      out[0] = bad ? UTF8_REPLACEMENT : codepoint;
+      return 1;
+    }
+
+    // Cut short
+    needed = 0;
+    out[0] = UTF8_REPLACEMENT;
+    return 1 + start(b, &out[1]);
+  }
+
+  return start(b, &out[0]);
+}
+
+uint8_t Utf8Decoder::start(uint8_t b, uint16_t *out)
+{
+  if (b < 0x80) {
+    *out = b;
+    return 1;
+  }
+  if (b >= 0xc2 && b <= 0xdf) {
+    codepoint = b & 0x1f;
+    minimum = 0x80;
+    needed = 1;
+  } else if (b >= 0xe0 && b <= 0xef) {
+    codepoint = b & 0x0f;
+    minimum = 0x800;
+    needed = 2;
+  } else if (b >= 0xf0 && b <= 0xf4) {
+    codepoint = b & 0x07;
+    minimum = 0x10000;
+    needed = 3;
+  } else {
+    // A stray continuation byte, or one that's never valid
+    *out = UTF8_REPLACEMENT;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef __UTF8DECODER_H
+#define __UTF8DECODER_H
+
+#include <stdint.h>
+
+// Turns a stream of UTF-8 bytes, fed one at a time, in to code points.
+// Anything malformed (stray continuation bytes, overlong forms,
+// surrogates, a sequence cut short) comes out as one U+FFFD, and so
+// does anything past the BMP, which no font here has glyphs for.
+
+#define UTF8_REPLACEMENT 0xfffd
+
+class Utf8Decoder {
+ public:
+  Utf8Decoder();
+
+  void reset();
+
+  // Returns how many code points b completed (0-2: a byte that cuts a
+  // sequence short gives U+FFFD for it, then counts for itself)
+  uint8_t decode(uint8_t b, uint16_t out[2]);
+
+ private:
+  uint8_t start(uint8_t b, uint16_t *out);
+
+  uint32_t codepoint;
+  uint32_t minimum; // anything below this was an overlong form
+  uint8_t needed; // continuation bytes still to come
+};
+
+#endif
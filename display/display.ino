@@ -10,22 +10,24 @@
 #include <ESP8266httpUpdate.h>
 
 #include "LEDAbstraction.h"
-#include "RingPixels.h"
-#include <RingBuffer.h>
+#include "TextScroller.h"
 
 #include "tetris.h"
 #include "tetris-clock.h"
+#include "tetris-autopilot.h"
+#include "snake-autopilot.h"
 #include "snake.h"
+#include "GameInput.h"
+#include "InputLog.h"
+#include "Palette.h"
+#include "InputQueue.h"
+#include "Transition.h"
 
 #include <SunriseCalc.h> // from https://github.com/JorjBauer/SunriseCalc
 #include <TimeLib.h>
 
 #include <FS.h>
 
-#include "font5x7.h"
-#define CHAR_WIDTH 6
-#define CHAR_HEIGHT 7
-
 // Debugging: store state in RTC RAM so we can tell (post-reboot) where the watchdog fired
 #define RTC_BASE 28
 #define STATE_SIZE 24
@@ -52,20 +54,42 @@ bool udpRunStarted = false;
 
 const int ESP_BUILTIN_LED = 1;
 
-// Offscreen text buffering
-#define BACKINGTEXTSIZE 100
-RingBuffer backingText(BACKINGTEXTSIZE);
-
-// Offscreen pixel buffering
-#define BACKINGPIXELSIZE 24
-RingPixels backingPixels(NUM_ROWS, BACKINGPIXELSIZE);
+TextScroller textScroller(&ledPanel);
+uint16_t textScrollMillis = TEXT_SCROLL_MILLIS;
 
 Tetris tetrisEngine;
+TetrisAutopilot autopilot(&tetrisEngine);
 Snake snakeEngine;
+SnakeAutopilot snakePilot(&snakeEngine);
+InputLog inputLog;
+#define INPUTLOGFILE "/inputlog.bin"
 bool needsRefresh = true;
 bool checkLines = false;
 bool running = false;
 
+// All input (network and web) is queued here and applied in order
+// once per pass through loop()
+InputQueue inputQueue;
+
+// Completed lines flash off-on off-on. This runs a frame per pass
+// through loop() instead of blocking; input that arrives while it's
+// running waits in inputQueue until it's done.
+#define LINEFLASH_FRAMES 4
+#define LINEFLASH_MILLIS 150
+uint8_t lineFlashFrame = 0; // 0 when idle; else 1 + the next frame to draw
+uint32_t nextLineFlash;
+
+// Moving between clock, tree and attract mode is also a frame per pass,
+// with the new mode running underneath as it's uncovered. If something
+// else changes currentMode first, the transition is dropped.
+Transition transition(&ledPanel);
+uint8_t transitionMode;
+uint32_t nextTransitionFrame;
+
+// Worst-case time through loop(), for /status
+uint32_t maxLoopMillis = 0;
+uint32_t lastLoopMillis = 0;
+
 uint32_t nextTick = 0;
 uint32_t nextTimeUpdate = 0;
 int32_t sunriseAt = -1; // minutes since midnight, or -1 for "none"
@@ -86,6 +110,17 @@ bool clockRestarting = false;
 
 bool colorWheelMode = false;
 
+// Attract mode: an autopilot plays Tetris or Snake (taking turns)
+// instead of blanking the display between clock faces
+bool attractMode = false;
+uint32_t attractEndsAt;
+uint32_t nextAttractMove;
+#define ATTRACT_DURATION 45000
+#define ATTRACT_MOVE_MILLIS 120
+#define ATTRACT_STEP_MILLIS 500
+#define ATTRACT_SNAKE_STEP_MILLIS 80
+#define ATTRACT_THINK_MICROS 2000 // search budget per pass through loop()
+
 bool autoBrightness = true;
 
 int32_t lastCorrection = 0; // When we NTP, save the # of seconds drifted
@@ -99,11 +134,13 @@ enum {
   mode_startup  = 3,
   mode_pickGame = 4,
   mode_snake    = 5,
-  mode_tree     = 6
+  mode_tree     = 6,
+  mode_attract  = 7
 };
 
 uint8_t currentMode = mode_startup;
 uint8_t currentGameSelection = mode_tetris; // for the menu
+uint8_t attractGame = mode_tetris; // which one the attract mode plays next
 uint32_t pickGameTimeout;
 
 #define MENUTIMEOUT 120000
@@ -145,6 +182,25 @@ void handleStatus() {
   r = templ.addRepvar(r, String("@PASS@"), String(myprefs.password));
   r = templ.addRepvar(r, String("@UPTIME@"), String(millis()));
   r = templ.addRepvar(r, String("@HEAP@"), String(ESP.getFreeHeap()));
+  r = templ.addRepvar(r, String("@MAXLOOP@"), String(maxLoopMillis));
+  r = templ.addRepvar(r, String("@LASTLOOP@"), String(lastLoopMillis));
+  char layoutbuf[160];
+  snprintf(layoutbuf, sizeof(layoutbuf), "%d panel(s), %dx%d, %d LEDs; %d bytes of frame buffers, %d bytes of map in flash; show takes %lu us (expect %lu)",
+	  PANEL_TILE_COUNT, DISPLAY_WIDTH, DISPLAY_HEIGHT, NUM_LEDS,
+	  (int) LED_BUFFER_BYTES, (int) sizeof(panelMap),
+	  (unsigned long) ledPanel.lastShowMicros(), (unsigned long) PANEL_SHOW_MICROS);
+  r = templ.addRepvar(r, String("@LEDLAYOUT@"), String(layoutbuf));
+  r = templ.addRepvar(r, String("@SHOWRATE@"), String(ledPanel.showsPerSecond()));
+  r = templ.addRepvar(r, String("@SHOWS@"), String(ledPanel.showCount()));
+  r = templ.addRepvar(r, String("@SKIPPEDSHOWS@"), String(ledPanel.skippedShowCount()));
+  r = templ.addRepvar(r, String("@INPUTDEPTH@"), String(inputQueue.depth()));
+  r = templ.addRepvar(r, String("@INPUTAGE@"), String(inputQueue.oldestAge(millis())));
+  r = templ.addRepvar(r, String("@INPUTMAXDEPTH@"), String(inputQueue.maxDepth()));
+  r = templ.addRepvar(r, String("@INPUTMAXAGE@"), String(inputQueue.maxAge()));
+  r = templ.addRepvar(r, String("@INPUTDROPS@"), String(inputQueue.drops()));
+  r = templ.addRepvar(r, String("@TEXTDROPS@"), String(textScroller.droppedBytes()));
+  r = templ.addRepvar(r, String("@GLYPHHITS@"), String(textScroller.glyphHits()));
+  r = templ.addRepvar(r, String("@GLYPHMISSES@"), String(textScroller.glyphMisses()));
   r = templ.addRepvar(r, String("@ID@"), String(ESP.getChipId()));
   r = templ.addRepvar(r, String("@MDNS@"), String(myprefs.mdnsName));
   r = templ.addRepvar(r, String("@COMMENT@"), String(myprefs.comment));
@@ -176,6 +232,7 @@ void handleStatus() {
                               (currentMode == mode_pickGame) ? "mode_pickGame":
                               (currentMode == mode_snake) ? "mode_snake" :
                               (currentMode == mode_tree) ? "mode_tree" :
+                              (currentMode == mode_attract) ? "mode_attract" :
                               "unknown mode"));
   r = templ.addRepvar(r, String("@SCORE@"),
                       String( (currentMode == mode_tetris) ? tetrisEngine.score() :
@@ -213,10 +270,7 @@ void handleTetris() {
 }
 
 void handleLeft() {
-  if (currentMode == mode_tetris)
-    tetrisEngine.MoveLeft();
-  else if (currentMode == mode_snake)
-    snakeEngine.TurnLeft();
+  inputQueue.push('a', INPUT_GAME, millis());
   String s = "ok";
   server.send(200, "text/html", s);
   needsRefresh = true;
@@ -225,10 +279,7 @@ void handleLeft() {
 }
 
 void handleRight() {
-  if (currentMode == mode_tetris)
-    tetrisEngine.MoveRight();
-  else if (currentMode == mode_snake)
-    snakeEngine.TurnRight();
+  inputQueue.push('d', INPUT_GAME, millis());
   String s = "ok";
   server.send(200, "text/html", s);
   needsRefresh = true;
@@ -237,8 +288,7 @@ void handleRight() {
 }
 
 void handleRotateLeft() {
-  if (currentMode == mode_tetris)
-    tetrisEngine.RotateLeft();
+  inputQueue.push('q', INPUT_GAME, millis());
   String s = "ok";
   server.send(200, "text/html", s);
   needsRefresh = true;
@@ -247,8 +297,7 @@ void handleRotateLeft() {
 }
 
 void handleRotateRight() {
-  if (currentMode == mode_tetris)
-    tetrisEngine.RotateRight();
+  inputQueue.push('e', INPUT_GAME, millis());
   String s = "ok";
   server.send(200, "text/html", s);
   needsRefresh = true;
@@ -257,10 +306,7 @@ void handleRotateRight() {
 }
 
 void handleStep() {
-  if (currentMode == mode_tetris)
-    tetrisEngine.Step();
-  else if (currentMode == mode_snake)
-    snakeEngine.Step();
+  inputQueue.push('s', INPUT_GAME, millis());
   String s = "ok";
   server.send(200, "text/html", s);
   needsRefresh = true;
@@ -269,11 +315,7 @@ void handleStep() {
 }
 
 void handleDrop() {
-  if (currentMode == mode_tetris) {
-    if (!tetrisEngine.Drop()) {
-      gameOver();
-    }
-  }
+  inputQueue.push(' ', INPUT_GAME, millis());
   String s = "ok";
   server.send(200, "text/html", s);
   needsRefresh = true;
@@ -282,10 +324,20 @@ void handleDrop() {
 }
 
 void handleInit() {
+  // Close out any game that was being recorded
+  endInputLog();
+
+  // Each game gets its own seed, which goes in the input log so the
+  // game can be replayed
+  uint32_t seed = random(0x7FFFFFFF) + 1;
   if (currentMode == mode_tetris) {
+    tetrisEngine.Seed(seed);
     tetrisEngine.Init();
+    inputLog.begin(INPUTLOG_TETRIS, seed, millis());
   } else if (currentMode == mode_snake) {
+    snakeEngine.Seed(seed);
     snakeEngine.Init();
+    inputLog.begin(INPUTLOG_SNAKE, seed, millis());
   }
   String s = "ok";
   server.send(200, "text/html", s);
@@ -304,30 +356,27 @@ void handleTest() {
   udpRunStarted = false;
   needsRefresh = false;
 
-  CRGB colors[8] = { CRGB::White,
-		     CHSV(HUE_ORANGE,255,255),
-		     CHSV(HUE_YELLOW,255,255),
-		     CHSV(HUE_AQUA,255,255),
-		     CHSV(HUE_BLUE,255,255),
-		     CHSV(HUE_PURPLE,255,255),
-		     CHSV(HUE_PINK,255,255),
-		     CHSV(HUE_GREEN,255,255) };
-
-
+  // One of the seven pieces, or the snake
   for (int y=0; y<YSIZE; y++) {
     for (int x=0; x<XSIZE; x++) {
-      ledPanel.SetLED(x,y,colors[random(104)%8]);
+      ledPanel.SetLED(x,y,palette[PAL_I + random(104)%8]);
     }
   }
+
+  // Whatever game is in progress will need a full redraw
+  tetrisEngine.MarkAllDirty();
+  snakeEngine.MarkAllDirty();
 }
 
-void addTextToBackingStore(String s)
+// Returns how many bytes didn't fit
+int addTextToBackingStore(String s)
 {
+  int dropped = 0;
   for (int i=0; i<s.length(); i++) {
-    if (!backingText.isFull()) {
-      backingText.addByte(s[i]);
-    }
+    if (!textScroller.addChar(s[i]))
+      dropped++;
   }
+  return dropped;
 }
 
 bool updateTime()
@@ -419,13 +468,20 @@ bool updateTime()
   return true;
 }
 
+void startTransition(uint8_t kind, void (*then)())
+{
+  // then() runs straight away, so this is the mode being uncovered
+  transition.start(kind, then);
+  transitionMode = currentMode;
+  nextTransitionFrame = millis();
+}
+
 void startTreeMode()
 {
   treeCounter = 10 * 30; // FIXME: 30 second constant
   currentMode = mode_tree;
   ledPanel.setFadeMode(false);
   ledPanel.clear();
-  ledPanel.Update();
 
   currentTreeBlinkers = 0;
 
@@ -440,12 +496,25 @@ void handleStartTree()
   startTreeMode();
 }
 
+// The clock face scrolls away, leaving the panel dark
+void clockBlanked()
+{
+  ledPanel.clear();
+  nextTick = millis() + 45 * 1000;
+  clockShowing = false;
+  clockRestarting = true;
+  if (attractMode) {
+    // Play for a while instead of blanking; this comes back to
+    // the clock when it's done
+    startAttractMode();
+  }
+}
+
 void startClockMode()
 {
   currentMode = mode_clock;
   ledPanel.setFadeMode(false);
   ledPanel.clear();
-  ledPanel.Update();
 
   clockRestarting = true;
   nextTick = millis();
@@ -481,6 +550,29 @@ void handleTestClock()
   nextTick = millis();
 }
 
+// Pause (p=1), resume (p=0), change the speed (speed=percent) or scrub
+// to a frame (f=) of the clock face that's dropping in
+void handleClockPlayback()
+{
+  ClockTimeline *t = clockDriver->playback();
+  if (server.hasArg("p")) {
+    t->setPaused(server.arg("p").toInt());
+  }
+  if (server.hasArg("speed")) {
+    t->setSpeed(server.arg("speed").toInt());
+  }
+  if (server.hasArg("f") && currentMode == mode_clock && clockShowing) {
+    t->seek(server.arg("f").toInt());
+    nextTick = millis() + t->frameDelay();
+  }
+
+  char buf[100];
+  sprintf(buf, "ok: frame %u of %u (%lu ms), %s at %u%%",
+	  t->position(), t->frames(), (unsigned long) t->duration(),
+	  t->paused() ? "paused" : "playing", t->speed());
+  server.send(200, "text/html", buf);
+}
+
 void handleText() {
   String s = "ok: ";
   running = false;
@@ -489,11 +581,23 @@ void handleText() {
 
   currentMode = mode_text;
   ledPanel.setFadeMode(true);
+  textScroller.redraw();
+
+  if (server.hasArg("ms")) {
+    // Time between steps; 250 was a little bit unbearably slow
+    textScrollMillis = constrain(server.arg("ms").toInt(), 10, 1000);
+  }
+
+  if (server.hasArg("c")) {
+    textScroller.addColor(server.arg("c").toInt());
+  }
+  int dropped = addTextToBackingStore(server.arg("s"));
 
   s = s + server.arg("s");
+  if (dropped) {
+    s = s + " (" + String(dropped) + " bytes dropped; the text buffer is full)";
+  }
   server.send(200, "text/html", s);
-
-  addTextToBackingStore(server.arg("s"));
 }
 
 void handleBrightness() {
@@ -532,6 +636,149 @@ void handleColorWheel() {
   server.send(200, "text/html", buf);
 }
 
+void handleTheme() {
+  String a = server.arg("t");
+  uint8_t t = a.length() ? a.toInt() : (paletteTheme() + 1) % NUMTHEMES;
+  setPaletteTheme(t);
+
+  char buf[50];
+  sprintf(buf, "ok: theme is now %d", paletteTheme());
+  server.send(200, "text/html", buf);
+
+  // Whatever game is on screen has to be redrawn in the new colors, and
+  // so does a clock face that's up (the blinking tree has colors of its
+  // own)
+  tetrisEngine.MarkAllDirty();
+  snakeEngine.MarkAllDirty();
+  needsRefresh = true;
+  if (currentMode == mode_clock && !clockRestarting) {
+    clockDriver->playback()->redraw();
+  }
+}
+
+void handleOrientation() {
+  String a = server.arg("o");
+  uint8_t o = a.length() ? a.toInt() : !textScroller.orientation();
+  textScroller.setOrientation(o);
+
+  char buf[50];
+  sprintf(buf, "ok: text is now %s", textScroller.orientation() == FONT_UPRIGHT ? "upright" : "sideways");
+  server.send(200, "text/html", buf);
+}
+
+void handleAttract() {
+  attractMode = !attractMode;
+  char buf[50];
+  sprintf(buf, "Attract mode is %s", attractMode ? "on" : "off");
+  server.send(200, "text/html", buf);
+}
+
+void startAttractMode()
+{
+  currentMode = mode_attract;
+  ledPanel.setFadeMode(false);
+  ledPanel.clear();
+
+  if (attractGame == mode_snake) {
+    snakeEngine.Init();
+    nextTick = millis() + ATTRACT_SNAKE_STEP_MILLIS;
+  } else {
+    tetrisEngine.Init();
+    autopilot.reset();
+    nextTick = millis() + ATTRACT_STEP_MILLIS;
+  }
+  needsRefresh = true;
+
+  nextAttractMove = millis();
+  attractEndsAt = millis() + ATTRACT_DURATION;
+}
+
+// Is Tetris what's on the display (played by a person or the autopilot)?
+bool playingTetris()
+{
+  return (currentMode == mode_tetris ||
+	  (currentMode == mode_attract && attractGame == mode_tetris));
+}
+
+bool playingSnake()
+{
+  return (currentMode == mode_snake ||
+	  (currentMode == mode_attract && attractGame == mode_snake));
+}
+
+void snakeAttractLoop()
+{
+  if (millis() < nextTick) {
+    return;
+  }
+
+  char c = snakePilot.nextMove();
+  if (c) {
+    snakeInput(&snakeEngine, c);
+  }
+  if (!snakeEngine.Step()) {
+    // Only once it has filled the board; start over
+    snakeEngine.Init();
+  }
+  needsRefresh = true;
+  nextTick = millis() + ATTRACT_SNAKE_STEP_MILLIS;
+}
+
+void attractLoop()
+{
+  if (millis() >= attractEndsAt) {
+    // The other game gets a turn next time
+    attractGame = (attractGame == mode_tetris) ? mode_snake : mode_tetris;
+    startTransition(TRANSITION_DISSOLVE, startClockMode);
+    return;
+  }
+
+  if (attractGame == mode_snake) {
+    snakeAttractLoop();
+    return;
+  }
+
+  if (lineFlashFrame) {
+    // The autopilot can keep thinking, but the game waits for the
+    // flashing lines
+    autopilot.think(ATTRACT_THINK_MICROS);
+    return;
+  }
+
+  autopilot.think(ATTRACT_THINK_MICROS);
+
+  bool alive = true;
+  if (millis() >= nextAttractMove) {
+    char c = autopilot.nextMove();
+    if (c) {
+      alive = tetrisInput(&tetrisEngine, c);
+      if (c == ' ') {
+	checkLines = true;
+	autopilot.reset();
+      }
+      needsRefresh = true;
+      nextAttractMove = millis() + ATTRACT_MOVE_MILLIS;
+    }
+  }
+
+  if (alive && millis() >= nextTick) {
+    alive = tetrisEngine.Step();
+    if (tetrisEngine.changedPieceThisTurn()) {
+      autopilot.reset();
+    }
+    checkLines = true;
+    needsRefresh = true;
+    nextTick = millis() + ATTRACT_STEP_MILLIS;
+  }
+
+  if (!alive) {
+    // Topped out; just start another game
+    tetrisEngine.Init();
+    autopilot.reset();
+    needsRefresh = true;
+  }
+}
+
 void handleUpdate() {
   nextTimeUpdate = 0;
   char buf[50];
@@ -662,6 +909,7 @@ void setup()
   location = NULL;
   
   ledPanel.Init();
+  setPaletteTheme(THEME_CLASSIC);
 
   ledPanel.setFadeMode(true);
 
@@ -671,6 +919,7 @@ void setup()
 
   tetrisEngine.Init();
   snakeEngine.Init();
+  inputLog.setSink(writeInputLog);
 
   server.on("/l", handleLeft);
   server.on("/r", handleRight);
@@ -685,9 +934,13 @@ void setup()
   server.on("/status2", handleStatus); // override default behavior FIXME wound up using a new URI b/c I can't override default...
   server.on("/startclock", handleStartClock);
   server.on("/testclock", handleTestClock);
+  server.on("/clockplayback", handleClockPlayback);
   server.on("/brightness", handleBrightness);
   server.on("/autobrightness", handleAutoBrightness);
   server.on("/color", handleColorWheel);
+  server.on("/attract", handleAttract);
+  server.on("/theme", handleTheme);
+  server.on("/orientation", handleOrientation);
   server.on("/update", handleUpdate);
   server.on("/config2", handleConfig); // override default behavior FIXME
   server.on("/submit2", handleSubmit); // override default behavior FIXME
@@ -705,142 +958,107 @@ void setup()
   clockDriver = new TetrisClock(&ledPanel);
 }
 
-void handleChar(char c)
+// Apply one input to whichever game is being played, and log it
+void gameInput(char c)
 {
-  switch (c) {
-  case 'a': 
-    if (currentMode == mode_tetris) 
-      tetrisEngine.MoveLeft();
-    else if (currentMode == mode_snake)
-      snakeEngine.TurnLeft();
-    else if (currentMode == mode_pickGame) {
-      if (currentGameSelection == mode_tetris) {
-	currentGameSelection = mode_snake;
-      } else {
-	currentGameSelection = mode_tetris;
-      }
-      pickGameTimeout = millis() + MENUTIMEOUT;
-    }
-    break;
-  case 'd':
-    if (currentMode == mode_tetris)
-      tetrisEngine.MoveRight();
-    else if (currentMode == mode_snake)
-      snakeEngine.TurnRight();
-    else if (currentMode = mode_pickGame) {
-      currentMode = currentGameSelection;
-      handleInit();
-    }
-    break;
-  case 'q': 
-    if (currentMode == mode_tetris)
-      tetrisEngine.RotateLeft();
-    break;
-  case 'e':
-    if (currentMode == mode_tetris)
-      tetrisEngine.RotateRight();
-    break;
-  case '!':
-    udpRunStarted = true; // We're playing tetris in real-time w/o a TCP connection
-    break;
-  case 's':
-    if (currentMode == mode_tetris) {
-      if (!tetrisEngine.Step()) {
-	gameOver();
-      }
+  if (currentMode == mode_tetris) {
+    inputLog.record(millis(), c);
+    if (!tetrisInput(&tetrisEngine, c)) {
+      gameOver();
+    } else if (c == 's' || c == ' ') {
       checkLines = true;
-    } else if (currentMode == mode_snake){
-      if (!snakeEngine.Step()) {
-	gameOver();
-      }
     }
-    break;
-  case ' ':
-    if ((currentMode == mode_tetris) && !tetrisEngine.Drop()) {
-      // restart
+  } else if (currentMode == mode_snake) {
+    inputLog.record(millis(), c);
+    if (!snakeInput(&snakeEngine, c)) {
       gameOver();
-      checkLines = true;
     }
-    break;
   }
 }
 
-void handleUdp(int byteCount)
+// Pass the input log along to SPIFFS as it fills up
+void writeInputLog(const uint8_t *data, uint16_t len, bool first)
 {
-  if (byteCount < sizeof(packetBuffer)) {
-    Udp.read(packetBuffer, byteCount);
+  if (!fsRunning)
+    return;
 
-    handleChar(packetBuffer[0]);
+  fs::File f = SPIFFS.open(INPUTLOGFILE, first ? "w" : "a");
+  if (f) {
+    f.write(data, len);
+    f.close();
   }
 }
 
-void textLoop()
+void endInputLog()
 {
-  static uint32_t nextMillis = 0;
-
-  if (millis() >= nextMillis) {
-    // Shift display 1 pixel
-    for (int y=0; y<YSIZE-1; y++) {
-      for (int x=0; x<XSIZE; x++) {
-	ledPanel.SetLED(x, y, 
-			ledPanel.GetLED(x,y+1));
-      }
-    }
+  inputLog.end(millis(), (inputLog.game() == INPUTLOG_SNAKE) ?
+	       snakeEngine.BoardHash() : tetrisEngine.BoardHash());
+}
 
-    // Shift in 1 pixel of what's offscreen
-    if (backingPixels.hasData()) {
-      byte *p = backingPixels.consumeLine();
-      for (int i=0; i<8; i++) {
-	ledPanel.SetLED(i, 31, p[i] ? CRGB::White : CRGB::Black);
-      }
-    } else if (!backingText.hasData() && currentMode == mode_startup) {
-      startClockMode();
-    }
+void handleChar(char c)
+{
+  if (c == '!') {
+    udpRunStarted = true; // We're playing tetris in real-time w/o a TCP connection
+    return;
+  }
 
-    // If there's text to be placed in the backing pixels buffer and
-    // there's space, then do it
-    if (backingText.hasData() && backingPixels.freeSpace() > CHAR_WIDTH+1) {
-      addCharToBackingStore(backingText.consumeByte());
+  if (currentMode == mode_tetris || currentMode == mode_snake) {
+    gameInput(c);
+  } else if (c == 'a' && currentMode == mode_pickGame) {
+    if (currentGameSelection == mode_tetris) {
+      currentGameSelection = mode_snake;
+    } else {
+      currentGameSelection = mode_tetris;
     }
+    pickGameTimeout = millis() + MENUTIMEOUT;
+  } else if (c == 'd') {
+    // Start the selected game (from the menu, or from any other mode)
+    currentMode = currentGameSelection;
+    handleInit();
+  }
+}
 
-    nextMillis = millis() + 100; // 250 was a little bit unbearably slow
+// Every byte of a datagram is an event, so a remote can send a batch
+// of moves in one packet
+void handleUdp(int byteCount)
+{
+  while (byteCount > 0) {
+    int n = Udp.read(packetBuffer, sizeof(packetBuffer));
+    if (n <= 0)
+      break;
+    inputQueue.pushBatch(packetBuffer, n, INPUT_REMOTE, millis());
+    byteCount -= n;
   }
 }
 
-void addCharToBackingStore(char c)
+void applyInput()
 {
-  // Construct each column of pixels from the XPM data & push them on the backing pixel store
-  for (uint8_t x=0; x<CHAR_WIDTH; x++) {
-    uint8_t columnData = 0;
-    for (uint8_t y=0; y<CHAR_HEIGHT; y++) {
-      uint8_t d = pgm_read_byte(&font5x7_xpm[3+y][((c-' ')*CHAR_WIDTH)+x]);
-      if (d == '.') {
-	columnData |= 1<<y;
-      }
+  // In order, but not while lines are flashing; and after a step or
+  // drop that completes lines, stop so that the flash happens before
+  // anything else does
+  inputEvent ev;
+  while (!lineFlashFrame && !checkLines && inputQueue.pop(&ev, millis())) {
+    if (ev.source == INPUT_GAME) {
+      gameInput(ev.c);
+    } else {
+      handleChar(ev.c);
     }
-    addColumnToBackingStore(columnData);
+    needsRefresh = true;
   }
 }
 
-void addColumnToBackingStore(uint8_t data)
+void textLoop()
 {
-  // Don't allow overflow; just drop the excess data
-  if (backingPixels.isFull())
-    return;
-
-  // If there's no data in the backing pixel buffer, then we want to
-  // insert at index 0.
-  byte storeData[NUM_ROWS];
+  static uint32_t nextMillis = 0;
 
- for (int y=0; y<NUM_ROWS; y++) {
-   if (data & (1 << ((NUM_ROWS-1)-y))) {
-     storeData[y] = 1;
-   } else {
-     storeData[y] = 0;
-   }
- }
+  if (millis() >= nextMillis) {
+    if (!textScroller.step() && !textScroller.hasData() &&
+	currentMode == mode_startup) {
+      startClockMode();
+    }
 
- backingPixels.addLine(storeData);
+    nextMillis = millis() + textScrollMillis;
+  }
 }
 
 // Debugging watchdog timeouts by storing private data in the RTC ram, which survives a reboot
@@ -869,10 +1087,10 @@ void loop() {
   tlog.loop();
 
   WLOG(4);
-  int noBytes = Udp.parsePacket();
-  if (noBytes) {
+  // Take every pending datagram, not just the first
+  int noBytes;
+  while ((noBytes = Udp.parsePacket()) > 0) {
     handleUdp(noBytes);
-    needsRefresh = true;
   }
 
   // cf https://forum.arduino.cc/index.php?topic=535898.0 for multiple
@@ -883,8 +1101,7 @@ void loop() {
   WLOG(5);
   if (tcpserver.hasClient() &&
       ( ( currentMode != mode_text ) ||
-	( (!backingText.hasData()) &&
-	  (!backingPixels.hasData()) ) )
+	( !textScroller.hasData() ) )
       ) {
     tcpclient = tcpserver.available();
     tcpclient.print("Hello again");
@@ -892,16 +1109,34 @@ void loop() {
     currentMode = mode_pickGame;
     pickGameTimeout = millis() + MENUTIMEOUT;
   }
-  if (tcpclient && tcpclient.available() > 0) {
-    char c = tcpclient.read();
-    handleChar(c);
-    needsRefresh = true;
+  // Only take as much as there's room for; the rest waits in the TCP
+  // stream, whose flow control holds the remote back. (UDP has no such
+  // thing, so datagrams that don't fit are dropped.)
+  while (tcpclient && tcpclient.available() > 0) {
+    int room = INPUTQUEUESIZE - inputQueue.depth();
+    if (room <= 0)
+      break;
+    int n = tcpclient.read(packetBuffer, min(room, (int) sizeof(packetBuffer)));
+    if (n <= 0)
+      break;
+    inputQueue.pushBatch(packetBuffer, n, INPUT_REMOTE, millis());
   }
 
+  applyInput();
+
   WLOG(6);
   clockDriver->loop();
 
   WLOG(7);
+  if (transition.active()) {
+    if (currentMode != transitionMode) {
+      transition.cancel();
+    } else if (millis() >= nextTransitionFrame) {
+      nextTransitionFrame = millis() + TRANSITION_FRAME_MILLIS;
+      transition.step();
+    }
+  }
+
   if (currentMode == mode_clock) {
     if (millis() >= nextTick) {	 
       if (clockRestarting) {
@@ -920,27 +1155,23 @@ void loop() {
 	
       WLOG(103);
       if (clockShowing) {
-	unsigned long thisDelay = clockDriver->step();
-	if (thisDelay == 0) {
+	if (clockDriver->step()) {
+	  nextTick = millis() + clockDriver->frameDelay();
+	} else if (clockDriver->showingTree()) {
+	  startTransition(TRANSITION_DISSOLVE, startTreeMode);
+	} else {
 	  // Done with the drawing; delay, then clear the screen
 	  nextTick = millis() + 15 * 1000;
 	  clockRestarting = false;
 	  clockShowing = false;
 	  colorWheelMode = true;
-	} else if (thisDelay == 99999) { // FIXME: terrible constant
-	  startTreeMode();
-	} else {
-	  nextTick = millis() + thisDelay;
 	}
       WLOG(104);
       } else {
 	// We've finished showing the time. Blank for a while and then start over.
         WLOG(105);
-	ledPanel.clearByScrolling();
 	colorWheelMode = false;
-	nextTick = millis() + 45 * 1000;
-	clockShowing = false;
-	clockRestarting = true;
+	startTransition(TRANSITION_SCROLL, clockBlanked);
         WLOG(106);
       }
     }
@@ -950,18 +1181,8 @@ void loop() {
   if ((currentMode == mode_tetris || currentMode == mode_snake) && 
       ((tcpclient && tcpclient.connected()) ||
        udpRunStarted)) {
-    if (millis() >= nextTick) {
-      if (currentMode == mode_tetris) {
-	if (!tetrisEngine.Step()) {
-	  gameOver();
-	}
-      } else {
-	if (!snakeEngine.Step()) {
-	  gameOver();
-	}
-      }
-      if (currentMode == mode_tetris)
-	checkLines = true;
+    if (!lineFlashFrame && millis() >= nextTick) {
+      gameInput('s');
       needsRefresh = true;
       int32_t nextDelay = 500;
       uint32_t curScore = (currentMode == mode_tetris) ? tetrisEngine.score() : snakeEngine.score();
@@ -975,80 +1196,51 @@ void loop() {
     }
   }
 
+  if (currentMode == mode_attract) {
+    attractLoop();
+  }
+
   WLOG(9);
-  if (currentMode == mode_tetris && needsRefresh) {
+  if (playingTetris() && needsRefresh) {
     if (tetrisEngine.changedPieceThisTurn()) {
       nextTick = millis() + 750;
     }
 
     if (checkLines) {
-      uint8_t f = tetrisEngine.numFilledLines();
-      if (f) {
-	for (int c=0; c<4; c++) { // flash off-on off-on
-	  for (int i=0; i<f; i++) { // for each solved line
-	    // This line needs to flash
-	    uint8_t l = tetrisEngine.lastFilledLineIndex(i);
-
-	    for (int x=0; x<XSIZE; x++) {
-	      ledPanel.SetLED(x, l, (c & 1) ? CRGB::White : CRGB::Black);
-	    }
-	  }
-          yield(); // feed the WDT. If this doesn't, then use delay(1) maybe
-	  ledPanel.Update();
-          yield(); // feed the WDT
-	  delay(150);
-	}
-      }
-      // have to reset the drop timer to compensate for time that just elapsed
-      if (tetrisEngine.changedPieceThisTurn()) {
-	nextTick = millis() + 750;
+      if (tetrisEngine.numFilledLines()) {
+	lineFlashFrame = 1;
+	nextLineFlash = millis();
       }
       checkLines = false;
     }
   }
 
+  if (lineFlashFrame) {
+    lineFlashLoop();
+  }
+
   WLOG(10);
-  if ((currentMode == mode_tetris || currentMode == mode_snake) &&
-      needsRefresh) {
+  if ((playingTetris() || playingSnake()) &&
+      needsRefresh && !lineFlashFrame) {
+    // Only redraw the cells the engine says have changed
+    bool isSnake = playingSnake();
+    uint32_t dirtyRows = isSnake ? snakeEngine.DirtyRows() : tetrisEngine.DirtyRows();
     for (int y=0; y<YSIZE; y++) {
+      if (!(dirtyRows & (1UL << y)))
+	continue;
+      uint8_t dirtyCells = isSnake ? snakeEngine.DirtyCells(y) : tetrisEngine.DirtyCells(y);
       for (int x=0; x<XSIZE; x++) {
-	uint8_t sq = (currentMode == mode_tetris) ? tetrisEngine.GetSquare(x,y) : snakeEngine.GetSquare(x,y);
-	CRGB outColor;
-	switch (sq) {
-	case 0:
-	case ' ':
-	  outColor = CHSV(0,0,0);
-	  break;
-
-	case '|':
-	  outColor = CRGB::White;
-	  break;
-	case '*':
-	  outColor = CHSV(HUE_ORANGE,255,255);
-	  break;
-	case 'z':
-	  outColor = CHSV(HUE_YELLOW,255,255);
-	  break;
-	case 'Z':
-	  outColor = CHSV(HUE_AQUA,255,255);
-	  break;
-	case 'L':
-	case '.': // food in snake game
-	  outColor = CHSV(HUE_BLUE,255,255);
-	  break;
-	case 'J':
-	  outColor = CHSV(HUE_PURPLE,255,255);
-	  break;
-	case 'T':
-	  outColor = CHSV(HUE_PINK,255,255);
-	  break;
-	default:
-	  outColor = CHSV(HUE_GREEN,255,255);
-	  break;
-	}
-	ledPanel.SetLED(x, y, outColor);
+	if (!(dirtyCells & (1 << x)))
+	  continue;
+	uint8_t sq = isSnake ? snakeEngine.GetSquareIndex(x,y) : tetrisEngine.GetSquareIndex(x,y);
+	ledPanel.SetLED(x, y, palette[sq]);
       }
     }
+    if (isSnake) {
+      snakeEngine.ClearDirty();
+    } else {
+      tetrisEngine.ClearDirty();
+    }
     needsRefresh = false;
   }
 
@@ -1060,23 +1252,23 @@ void loop() {
   WLOG(12);
   if (currentMode == mode_pickGame) {
     // Draw the basic menu
-    ledPanel.clear(true);
+    ledPanel.clear();
 
     // Tetris mode
-    ledPanel.SetLED(2, 10, CHSV(HUE_BLUE,255,255));
-    ledPanel.SetLED(3, 10, CHSV(HUE_BLUE,255,255));
-    ledPanel.SetLED(4, 10, CHSV(HUE_BLUE,255,255));
-    ledPanel.SetLED(3, 9, CHSV(HUE_BLUE,255,255));
-    ledPanel.SetLED(4, 9, CHSV(HUE_YELLOW,255,255));
-    ledPanel.SetLED(5, 9, CHSV(HUE_YELLOW,255,255));
-    ledPanel.SetLED(5, 10, CHSV(HUE_YELLOW,255,255));
-    ledPanel.SetLED(4, 8, CHSV(HUE_YELLOW,255,255));
+    ledPanel.SetLED(2, 10, palette[PAL_L]);
+    ledPanel.SetLED(3, 10, palette[PAL_L]);
+    ledPanel.SetLED(4, 10, palette[PAL_L]);
+    ledPanel.SetLED(3, 9, palette[PAL_L]);
+    ledPanel.SetLED(4, 9, palette[PAL_S]);
+    ledPanel.SetLED(5, 9, palette[PAL_S]);
+    ledPanel.SetLED(5, 10, palette[PAL_S]);
+    ledPanel.SetLED(4, 8, palette[PAL_S]);
 
     // Snake mode
-    ledPanel.SetLED(2, 22, CHSV(HUE_GREEN,255,255));
-    ledPanel.SetLED(3, 22, CHSV(HUE_GREEN,255,255));
-    ledPanel.SetLED(4, 22, CHSV(HUE_GREEN,255,255));
-    ledPanel.SetLED(6, 22, CHSV(HUE_BLUE,255,255));
+    ledPanel.SetLED(2, 22, palette[PAL_SNAKE]);
+    ledPanel.SetLED(3, 22, palette[PAL_SNAKE]);
+    ledPanel.SetLED(4, 22, palette[PAL_SNAKE]);
+    ledPanel.SetLED(6, 22, palette[PAL_FOOD]);
 
     // Draw the selection
     uint8_t boxStartY = 0;
@@ -1085,17 +1277,17 @@ void loop() {
     } else if (currentGameSelection == mode_snake) {
       boxStartY = 19;
     }
-    for (int x=0; x<=7; x++) {
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
       for (int y=boxStartY; y<=boxStartY + 6; y++) {
-	if (x==0 || x==7 || y==boxStartY || y==boxStartY+6)
-	  ledPanel.SetLED(x,y,CHSV(HUE_RED,255,255));
+	if (x==0 || x==DISPLAY_WIDTH-1 || y==boxStartY || y==boxStartY+6)
+	  ledPanel.SetLED(x,y,palette[PAL_SELECTION]);
       }
     }
 
   WLOG(13);
     if (millis() >= pickGameTimeout) {
       // Timed out waiting for input; go back to the clock
-      startClockMode();
+      startTransition(TRANSITION_WIPE, startClockMode);
     }
   }
 
@@ -1108,17 +1300,23 @@ void loop() {
 
   WLOG(15);
   EVERY_N_MILLISECONDS(35) {
-    if (colorWheelMode) {
-      WLOG(16);
-      ledPanel.stepColorWheel();
-      WLOG(17);
-    } else {
-      WLOG(18);
-      ledPanel.Update();
-      WLOG(19);
+    // The one show per frame: whatever the modes drew, under the effect
+    WLOG(16);
+    if (currentMode == mode_text || currentMode == mode_startup) {
+      textScroller.draw();
     }
+    ledPanel.setEffect(colorWheelMode ? EFFECT_COLORWHEEL : EFFECT_NONE);
+    ledPanel.stepEffect();
+    WLOG(18);
+    ledPanel.Update();
+    WLOG(19);
   }
   WLOG(20);
+
+  lastLoopMillis = millis() - sol;
+  if (lastLoopMillis > maxLoopMillis) {
+    maxLoopMillis = lastLoopMillis;
+  }
   
 #if 0
   static uint32_t nextAt = 0;
@@ -1147,11 +1345,50 @@ void loop() {
 #endif
 }
 
+void lineFlashLoop()
+{
+  if (!playingTetris()) {
+    // The game went away underneath us
+    lineFlashFrame = 0;
+    return;
+  }
+
+  if (millis() < nextLineFlash) {
+    return;
+  }
+
+  if (lineFlashFrame > LINEFLASH_FRAMES) {
+    // All done; the next refresh draws the board with the lines
+    // removed, and the drop timer starts over from now
+    lineFlashFrame = 0;
+    needsRefresh = true;
+    if (tetrisEngine.changedPieceThisTurn()) {
+      nextTick = millis() + 750;
+    }
+    applyInput(); // whatever arrived meanwhile
+    return;
+  }
+
+  uint8_t c = lineFlashFrame - 1;
+  for (int i=0; i<tetrisEngine.numFilledLines(); i++) { // for each solved line
+    uint8_t l = tetrisEngine.lastFilledLineIndex(i);
+    for (int x=0; x<XSIZE; x++) {
+      ledPanel.SetLED(x, l, palette[(c & 1) ? PAL_FLASH : PAL_EMPTY]);
+    }
+  }
+
+  lineFlashFrame++;
+  nextLineFlash = millis() + LINEFLASH_MILLIS;
+}
+
 void gameOver() {
+  uint8_t endedMode = currentMode;
+  endInputLog();
+  inputQueue.clear(); // the rest of the moves were for the game that just ended
+
   currentMode = mode_text;
 
-  backingText.clear();
-  backingPixels.clear();
+  textScroller.clear();
 
   addTextToBackingStore("  Game Over  ");
   if (tcpclient && tcpclient.connected()) {
@@ -1159,7 +1396,7 @@ void gameOver() {
     tcpclient.stop();
   }
   char buf[25];
-  sprintf(buf, "Score: %d     ", (currentMode == mode_tetris) ? tetrisEngine.score() : snakeEngine.score());
+  sprintf(buf, "Score: %d     ", (endedMode == mode_tetris) ? tetrisEngine.score() : snakeEngine.score());
   addTextToBackingStore(buf);
 }
 
@@ -1220,20 +1457,21 @@ void createNewTreeBlinker()
   ledPanel.SetLED(newX, newY, CRGB::Black);
 }
 
+void treeEnded()
+{
+  startClockMode();
+
+  colorWheelMode = false;
+  nextTick = millis() + 45 * 1000;
+  clockShowing = false;
+  clockRestarting = true;
+}
+
 void handleTreeBlinkers()
 {
   if (--treeCounter == 0) {
     // Done blinking - go back to clock mode
-
-    ledPanel.clearByScrolling();
-
-    startClockMode();
-
-    colorWheelMode = false;
-    nextTick = millis() + 45 * 1000;
-    clockShowing = false;
-    clockRestarting = true;
-
+    startTransition(TRANSITION_SCROLL, treeEnded);
     return;
   }
 
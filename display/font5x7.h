@@ -1,5 +1,5 @@
 /* XPM */
-static const PROGMEM char *font5x7_xpm[] = {
+static constexpr const char *font5x7_xpm[] = {
 "1424 8 2 1 ",
 "  c black",
 ". c white",
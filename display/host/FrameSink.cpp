@@ -0,0 +1,129 @@
+#include <Arduino.h>
+#include <FastLED.h>
+
+#include "FrameSink.h"
+#include "PanelGeometry.h"
+
+static uint8_t sinkKind;
+static FILE *sinkFile = NULL;
+static char sinkPrefix[200];
+static uint32_t sinkFrames = 0;
+static uint32_t sinkMicros = 0;
+
+static CRGB pixelAt(const CRGB *leds, uint8_t x, uint8_t y)
+{
+  uint16_t i = panelIndex(x, y);
+  if (i == PANEL_OFFSCREEN)
+    return CRGB(0, 0, 0);
+  return leds[i];
+}
+
+static void writeRaw(const CRGB *leds, uint32_t now)
+{
+  uint8_t stamp[4] = { (uint8_t) now, (uint8_t) (now >> 8),
+		       (uint8_t) (now >> 16), (uint8_t) (now >> 24) };
+  fwrite(stamp, 1, sizeof(stamp), sinkFile);
+  for (uint8_t y=0; y<DISPLAY_HEIGHT; y++) {
+    for (uint8_t x=0; x<DISPLAY_WIDTH; x++) {
+      CRGB c = pixelAt(leds, x, y);
+      fwrite(c.raw, 1, 3, sinkFile);
+    }
+  }
+  fflush(sinkFile);
+}
+
+static void writePPM(const CRGB *leds, uint32_t now)
+{
+  char name[sizeof(sinkPrefix) + 16];
+  snprintf(name, sizeof(name), "%s-%06u.ppm", sinkPrefix, sinkFrames);
+  FILE *f = fopen(name, "wb");
+  if (!f)
+    return;
+  fprintf(f, "P6\n# millis %u\n%d %d\n255\n", now, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  for (uint8_t y=0; y<DISPLAY_HEIGHT; y++) {
+    for (uint8_t x=0; x<DISPLAY_WIDTH; x++) {
+      CRGB c = pixelAt(leds, x, y);
+      fwrite(c.raw, 1, 3, f);
+    }
+  }
+  fclose(f);
+}
+
+// Two display rows per line of text: the upper half block takes the
+// foreground color and the lower one the background
+static void writeANSI(const CRGB *leds, uint32_t now)
+{
+  fprintf(sinkFile, "\x1b[H%8u ms  frame %u\x1b[K\n", now, sinkFrames);
+  for (uint8_t y=0; y<DISPLAY_HEIGHT; y+=2) {
+    for (uint8_t x=0; x<DISPLAY_WIDTH; x++) {
+      CRGB top = pixelAt(leds, x, y);
+      CRGB bottom = (y + 1 < DISPLAY_HEIGHT) ? pixelAt(leds, x, y + 1) : CRGB(0, 0, 0);
+      fprintf(sinkFile, "\x1b[38;2;%d;%d;%dm\x1b[48;2;%d;%d;%dm\xe2\x96\x80",
+	      top.r, top.g, top.b, bottom.r, bottom.g, bottom.b);
+    }
+    fprintf(sinkFile, "\x1b[0m\n");
+  }
+  fflush(sinkFile);
+}
+
+static void onShow(const CRGB *leds, int count)
+{
+  uint32_t start = micros();
+  uint32_t now = millis();
+  switch (sinkKind) {
+  case FRAMESINK_RAW:
+    writeRaw(leds, now);
+    break;
+  case FRAMESINK_PPM:
+    writePPM(leds, now);
+    break;
+  case FRAMESINK_ANSI:
+    writeANSI(leds, now);
+    break;
+  }
+  sinkFrames++;
+  sinkMicros += micros() - start;
+}
+
+bool frameSinkOpen(uint8_t kind, const char *where)
+{
+  frameSinkClose();
+
+  sinkKind = kind;
+  if (kind == FRAMESINK_PPM) {
+    snprintf(sinkPrefix, sizeof(sinkPrefix), "%s", where);
+  } else if (!strcmp(where, "-")) {
+    sinkFile = stdout;
+  } else {
+    sinkFile = fopen(where, "wb");
+    if (!sinkFile)
+      return false;
+  }
+  if (kind == FRAMESINK_ANSI) {
+    fprintf(sinkFile, "\x1b[2J");
+  }
+
+  sinkFrames = 0;
+  sinkMicros = 0;
+  FastLED.showHook = onShow;
+  return true;
+}
+
+void frameSinkClose()
+{
+  FastLED.showHook = NULL;
+  if (sinkFile && sinkFile != stdout) {
+    fclose(sinkFile);
+  }
+  sinkFile = NULL;
+}
+
+uint32_t frameSinkFrames()
+{
+  return sinkFrames;
+}
+
+uint32_t frameSinkMicros()
+{
+  return sinkMicros;
+}
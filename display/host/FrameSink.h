@@ -0,0 +1,24 @@
+#ifndef __FRAMESINK_H
+#define __FRAMESINK_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Captures every FastLED.show() on the host, laid out the way the
+// display sees it (not in chain order), stamped with the simulated
+// millis(). Colors are as written to the chain, before the global
+// brightness.
+
+#define FRAMESINK_RAW  0 // per frame: millis (4 bytes LE), then DISPLAY_WIDTH*DISPLAY_HEIGHT RGB triples by row
+#define FRAMESINK_PPM  1 // one <prefix>-NNNNNN.ppm per frame, millis in a comment
+#define FRAMESINK_ANSI 2 // redraws in place on a truecolor terminal
+
+// where is a file name ("-" for stdout) for RAW and ANSI, and a file
+// name prefix for PPM. Returns false if it can't be opened.
+bool frameSinkOpen(uint8_t kind, const char *where);
+void frameSinkClose();
+
+uint32_t frameSinkFrames();
+uint32_t frameSinkMicros(); // spent writing frames, to leave out of timings
+
+#endif
@@ -0,0 +1,189 @@
+// Checks the compiled clock timeline: a known face has the frame count
+// and total duration it always had, every face of the day (and the
+// tree) fits, and pausing, speeding up and scrubbing leave the panel
+// the same as playing straight through.
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include "tetris-clock.h"
+#include "ClockTimeline.h"
+#include "Palette.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static bool panelMatches(LEDAbstraction *panel, const CRGB *want)
+{
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
+      if ((CRGB) panel->GetLED(x, y) != want[y * DISPLAY_WIDTH + x])
+	return false;
+    }
+  }
+  return true;
+}
+
+static void copyPanel(LEDAbstraction *panel, CRGB *to)
+{
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
+      to[y * DISPLAY_WIDTH + x] = panel->GetLED(x, y);
+    }
+  }
+}
+
+// 12:34 is 14 pieces; the frame count and the delays (750ms as each
+// piece comes on, then 150ms a row while it moves and 50ms once it's
+// just falling) are what the clock has always done
+static void checkKnownFace()
+{
+  LEDAbstraction panel;
+  panel.Init();
+  panel.clear();
+  TetrisClock clock(&panel);
+  clock.setTime(12, 34, 0, 6, 1);
+
+  ClockTimeline *t = clock.playback();
+  check(t->frames() == 260, "12:34 is 260 frames");
+  check(t->duration() == 24900, "12:34 takes 24.9s");
+  check(!clock.showingTree(), "12:34 in June is the time");
+
+  uint16_t steps = 0;
+  uint32_t millis = 0;
+  while (clock.step()) {
+    steps++;
+    millis += clock.frameDelay();
+  }
+  check(steps == t->frames() && millis == t->duration(),
+	"playback walks the whole timeline");
+  check(t->position() == t->frames(), "played to the end");
+}
+
+static void checkEveryFace()
+{
+  LEDAbstraction panel;
+  panel.Init();
+  TetrisClock clock(&panel);
+
+  bool fits = true;
+  uint16_t longest = 0;
+  for (int h=0; h<24; h++) {
+    for (int m=0; m<60; m++) {
+      clock.setTime(h, m, 0, 6, 1);
+      // A face that doesn't fit is put straight in to place instead, a
+      // frame a piece
+      fits = fits && !clock.playback()->overflowed() && clock.playback()->frames() > QUEUESIZE;
+      if (clock.playback()->frames() > longest)
+	longest = clock.playback()->frames();
+    }
+  }
+  check(fits, "every time of day fits in the timeline");
+
+  clock.setTime(10, 15, 0, 12, 20);
+  check(clock.showingTree(), "quarter hours in late December are a tree");
+  check(!clock.playback()->overflowed() && clock.playback()->frames() == 415 &&
+	clock.playback()->duration() == 37250, "the tree is 415 frames over 37.25s");
+
+  printf("longest face %u frames, tree %u, of %u\n", longest,
+	 clock.playback()->frames(), TIMELINE_MAX_FRAMES);
+}
+
+static void checkPlayback()
+{
+  LEDAbstraction panel;
+  panel.Init();
+  panel.clear();
+  TetrisClock clock(&panel);
+  clock.setTime(8, 8, 0, 6, 1);
+  ClockTimeline *t = clock.playback();
+
+  static CRGB blank[DISPLAY_PIXELS], half[DISPLAY_PIXELS], whole[DISPLAY_PIXELS];
+  copyPanel(&panel, blank);
+
+  uint16_t middle = t->frames() / 2;
+  for (uint16_t i=0; i<middle; i++) {
+    clock.step();
+  }
+  copyPanel(&panel, half);
+
+  t->setPaused(true);
+  check(clock.step() && t->position() == middle && panelMatches(&panel, half),
+	"paused playback stands still");
+  check(clock.frameDelay() == TIMELINE_PAUSED_MILLIS, "paused playback polls");
+  t->setPaused(false);
+
+  t->setSpeed(200);
+  clock.step();
+  uint32_t fast = clock.frameDelay();
+  t->seek(t->position() - 1);
+  t->setSpeed(TIMELINE_NORMAL_SPEED);
+  clock.step();
+  check(fast * 2 == clock.frameDelay(), "double speed halves the delay");
+
+  while (clock.step())
+    ;
+  copyPanel(&panel, whole);
+
+  t->seek(0);
+  check(t->position() == 0 && panelMatches(&panel, blank), "scrubbing to the start undoes it all");
+  t->seek(middle);
+  check(panelMatches(&panel, half), "scrubbing forward matches playing");
+  t->seek(t->frames());
+  check(panelMatches(&panel, whole), "scrubbing to the end matches playing");
+  t->seek(middle);
+  check(panelMatches(&panel, half), "scrubbing back matches playing");
+  check(clock.step() && t->position() == middle + 1, "playback carries on from where it was scrubbed to");
+}
+
+// A face that's partly up and then redrawn in another theme looks the
+// same as one played that far in that theme
+static void checkRedraw()
+{
+  static CRGB want[DISPLAY_PIXELS];
+  LEDAbstraction panel;
+  panel.Init();
+  TetrisClock clock(&panel);
+  ClockTimeline *t = clock.playback();
+
+  setPaletteTheme(THEME_PASTEL);
+  panel.clear();
+  clock.setTime(10, 47, 0, 6, 1);
+  t->seek(t->frames() - 20);
+  copyPanel(&panel, want);
+
+  setPaletteTheme(THEME_CLASSIC);
+  panel.clear();
+  clock.setTime(10, 47, 0, 6, 1);
+  t->seek(t->frames() - 20);
+  check(!panelMatches(&panel, want), "the themes differ");
+  setPaletteTheme(THEME_PASTEL);
+  t->redraw();
+  check(t->position() == t->frames() - 20 && panelMatches(&panel, want),
+	"redraw() repaints the face in the new theme");
+  setPaletteTheme(THEME_CLASSIC);
+}
+
+int main(int argc, char *argv[])
+{
+  setPaletteTheme(THEME_CLASSIC);
+
+  checkKnownFace();
+  checkEveryFace();
+  checkPlayback();
+  checkRedraw();
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Checks the LED compositor: effects and overlays change what's shown
+// but never what a mode drew, each Update() is at most one show, and
+// only rows that changed are composited again.
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include "LEDAbstraction.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static CRGB shown(uint8_t x, uint8_t y)
+{
+  return FastLED.leds[panelIndex(x, y)];
+}
+
+int main(int argc, char *argv[])
+{
+  LEDAbstraction panel;
+  panel.Init();
+  panel.clear();
+
+  CRGB red = CRGB(200, 0, 0);
+  CRGB blue = CRGB(0, 0, 200);
+  panel.SetLED(1, 2, red);
+  panel.SetLED(3, 4, blue);
+
+  uint32_t before = FastLED.shows;
+  panel.Update();
+  check(FastLED.shows == before + 1, "a changed frame is one show");
+  check(shown(1, 2) == red && shown(3, 4) == blue, "base layer reaches the panel");
+  panel.Update();
+  check(FastLED.shows == before + 1, "an unchanged frame isn't shown");
+
+  // Color wheel recolors what's lit, and only on the panel
+  panel.setEffect(EFFECT_COLORWHEEL);
+  CRGB last = shown(1, 2);
+  bool cycled = true;
+  for (int i=0; i<10; i++) {
+    before = FastLED.shows;
+    panel.stepEffect();
+    panel.Update();
+    cycled = cycled && FastLED.shows == before + 1 && shown(1, 2) != last;
+    last = shown(1, 2);
+  }
+  check(cycled, "color wheel changes the panel once per frame");
+  check(shown(1, 2) == shown(3, 4), "every lit pixel takes the wheel color");
+  check(shown(0, 0) == CRGB(CRGB::Black), "dark pixels stay dark under the wheel");
+  check(panel.GetLED(1, 2) == red && panel.GetLED(3, 4) == blue,
+	"color wheel leaves the base layer alone");
+  panel.setEffect(EFFECT_NONE);
+  panel.Update();
+  check(shown(1, 2) == red && shown(3, 4) == blue, "colors return when the effect stops");
+
+  // Level scales the output, not the base
+  panel.setEffectLevel(128);
+  panel.Update();
+  check(shown(1, 2).r < red.r && shown(1, 2).r > 0, "level dims the panel");
+  check(panel.GetLED(1, 2) == red, "level leaves the base layer alone");
+  panel.setEffectLevel(255);
+  panel.Update();
+  check(shown(1, 2) == red, "full level restores the panel");
+
+  // Overlays sit on top, survive the base being cleared, and go away cleanly
+  CRGB green = CRGB(0, 200, 0);
+  check(panel.setOverlay(1, 2, green), "overlay pixel fits");
+  panel.Update();
+  check(shown(1, 2) == green && panel.GetLED(1, 2) == red, "overlay covers the base");
+  panel.clear();
+  panel.Update();
+  check(shown(1, 2) == green && shown(3, 4) == CRGB(CRGB::Black), "overlay survives clear()");
+  panel.clearOverlay(1, 2);
+  panel.Update();
+  check(shown(1, 2) == CRGB(CRGB::Black), "clearing the overlay shows the base again");
+
+  bool full = true;
+  for (uint8_t i=0; i<OVERLAY_PIXELS; i++) {
+    full = full && panel.setOverlay(i % DISPLAY_WIDTH, i / DISPLAY_WIDTH, green);
+  }
+  check(full && !panel.setOverlay(DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1, green),
+	"overlay refuses pixels past OVERLAY_PIXELS");
+  for (uint8_t i=0; i<OVERLAY_PIXELS; i++) {
+    panel.clearOverlay(i % DISPLAY_WIDTH, i / DISPLAY_WIDTH);
+  }
+  panel.Update();
+
+  // Cost follows the rows that changed: one pixel a frame against a
+  // full-panel effect every frame
+  const uint32_t frames = 20000;
+  uint32_t start = micros();
+  for (uint32_t f=0; f<frames; f++) {
+    panel.SetLED(f % DISPLAY_WIDTH, 5, ((f / DISPLAY_WIDTH) & 1) ? red : blue);
+    panel.Update();
+  }
+  uint32_t oneRow = micros() - start;
+  panel.setEffect(EFFECT_COLORWHEEL);
+  start = micros();
+  for (uint32_t f=0; f<frames; f++) {
+    panel.stepEffect();
+    panel.Update();
+  }
+  uint32_t allRows = micros() - start;
+  printf("%.2f us per one-row frame, %.2f us per full-panel frame\n",
+	 (double) oneRow / frames, (double) allRows / frames);
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
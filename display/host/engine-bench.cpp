@@ -0,0 +1,418 @@
+// Microbenchmarks for the game engines. Everything runs from a fixed
+// seed, so the numbers are comparable from one run to the next.
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include "tetris.h"
+#include "snake.h"
+#include "tetris-clock.h"
+#include "tetris-autopilot.h"
+#include "snake-autopilot.h"
+#include "GameInput.h"
+#include "LEDAbstraction.h"
+#include "Palette.h"
+#include "TextScroller.h"
+
+#define SEED 8267
+
+static void report(const char *what, uint32_t count, uint32_t elapsedMicros)
+{
+  if (elapsedMicros == 0)
+    elapsedMicros = 1;
+  printf("%-28s %10u in %7.3f s = %12.0f /sec\n", what, count,
+	 elapsedMicros / 1000000.0, count * 1000000.0 / elapsedMicros);
+}
+
+static void benchTetrisSteps()
+{
+  Tetris t;
+  t.Seed(SEED);
+  t.Init();
+
+  const uint32_t count = 2000000;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<count; i++) {
+    if (!t.Step()) {
+      t.Init();
+    }
+  }
+  report("tetris steps", count, micros() - start);
+}
+
+static void benchTetrisRotations()
+{
+  Tetris t;
+  t.Seed(SEED);
+  t.Init();
+  // Get the piece clear of the top so rotations aren't all kicks
+  for (int i=0; i<4; i++) {
+    t.Step();
+  }
+
+  const uint32_t count = 2000000;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<count; i++) {
+    if (i & 0x100) {
+      t.RotateLeft();
+    } else {
+      t.RotateRight();
+    }
+  }
+  report("tetris rotations", count, micros() - start);
+}
+
+// Fills rows of the board directly, to set up line clears
+class TetrisFixture {
+ public:
+  static void fillRow(Tetris *t, int8_t y, uint8_t pieceIdx)
+  {
+    for (int8_t x=0; x<XSIZE; x++) {
+      t->SetCell(x, y, pieceIdx);
+    }
+  }
+};
+
+static void benchTetrisLineClears()
+{
+  Tetris t;
+  t.Seed(SEED);
+
+  const uint32_t drops = 200000;
+  uint32_t lines = 0;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<drops; i++) {
+    t.Init();
+    for (int8_t y=YSIZE-4; y<YSIZE; y++) {
+      TetrisFixture::fillRow(&t, y, 1);
+    }
+    t.Drop();
+    lines += t.numFilledLines();
+  }
+  report("tetris line clears", lines, micros() - start);
+}
+
+static void applyMove(Tetris *t, char c)
+{
+  switch (c) {
+  case 'a': t->MoveLeft(); break;
+  case 'd': t->MoveRight(); break;
+  case 'q': t->RotateLeft(); break;
+  case 'e': t->RotateRight(); break;
+  }
+}
+
+static void benchAutopilot()
+{
+  Tetris t;
+  TetrisAutopilot pilot(&t);
+  t.Seed(SEED);
+  t.Init();
+
+  const uint32_t pieces = 20000;
+  uint32_t games = 1;
+  uint32_t lines = 0;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<pieces; i++) {
+    // Think in small slices, the way loop() does
+    while (!pilot.think(2000))
+      ;
+    char c;
+    while ((c = pilot.nextMove()) != ' ') {
+      applyMove(&t, c);
+    }
+    bool alive = t.Drop();
+    lines += t.numFilledLines();
+    pilot.reset();
+    if (!alive) {
+      games++;
+      t.Init();
+    }
+  }
+  uint32_t elapsed = micros() - start;
+  report("autopilot placements", pilot.placementsEvaluated(), elapsed);
+  printf("%-28s %10u lines in %u pieces, %u game(s)\n", "autopilot results",
+	 lines, pieces, games);
+}
+
+static void benchSnakeSteps()
+{
+  Snake s;
+  s.Seed(SEED);
+  s.Init();
+
+  const uint32_t count = 2000000;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<count; i++) {
+    if ((i & 7) == 0) {
+      s.TurnLeft();
+    } else if ((i & 7) == 4) {
+      s.TurnRight();
+    }
+    if (!s.Step()) {
+      s.Init();
+    }
+  }
+  report("snake steps", count, micros() - start);
+}
+
+// Steer the snake around a serpentine cycle that covers the whole
+// board, so it can get very long without running in to itself
+static void serpentineTurn(Snake *s)
+{
+  if (s->curY & 1) {
+    s->dirX = (s->curX > 0) ? -1 : 0;
+  } else {
+    s->dirX = (s->curX < XSIZE-1) ? 1 : 0;
+  }
+  s->dirY = s->dirX ? 0 : 1;
+}
+
+static void benchSnakeLongSteps(uint16_t length)
+{
+  Snake s;
+  s.Seed(SEED);
+  s.Init();
+  s.currentLength = length;
+  // Grow to length first
+  for (uint16_t i=0; i<length; i++) {
+    serpentineTurn(&s);
+    s.Step();
+  }
+
+  const uint32_t count = 2000000;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<count; i++) {
+    serpentineTurn(&s);
+    if (!s.Step()) {
+      s.Init();
+      s.currentLength = length;
+    }
+  }
+  char buf[40];
+  sprintf(buf, "snake steps (length %d)", length);
+  report(buf, count, micros() - start);
+}
+
+// Let the snake autopilot play whole games, until the snake fills the
+// board (or dies, which it shouldn't)
+static void benchSnakeAutopilot()
+{
+  Snake s;
+  s.Seed(SEED);
+  SnakeAutopilot pilot(&s);
+
+  const uint8_t games = 20;
+  uint32_t steps = 0;
+  uint32_t eaten = 0;
+  uint32_t decisionMicros = 0;
+  uint32_t filled = 0;
+  for (uint8_t g=0; g<games; g++) {
+    s.Init();
+    while (1) {
+      uint32_t start = micros();
+      char c = pilot.nextMove();
+      decisionMicros += micros() - start;
+      if (c) {
+	snakeInput(&s, c);
+      }
+      uint16_t before = s.currentLength;
+      steps++;
+      if (!s.Step())
+	break;
+      eaten += s.currentLength - before;
+    }
+    if (s.currentLength >= SNAKE_MAXLEN) {
+      filled++;
+    }
+  }
+  report("snake autopilot decisions", steps, decisionMicros);
+  printf("%-28s %10.2f us per decision, %.1f steps per food\n", "snake autopilot results",
+	 (double) decisionMicros / steps, (double) steps / eaten);
+  printf("%-28s %10u of %u games filled the board, in %u steps each\n", "",
+	 filled, games, steps / games);
+  printf("%-28s %10u shortcuts taken\n", "", pilot.shortcutsTaken());
+}
+
+static void benchClockFrames()
+{
+  LEDAbstraction panel;
+  panel.Init();
+  TetrisClock clock(&panel);
+
+  const uint32_t faces = 5000;
+  uint32_t frames = 0;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<faces; i++) {
+    clock.setTime(i % 24, i % 60, 0, 6, 1);
+    while (clock.step()) {
+      frames++;
+    }
+  }
+  report("clock frames", frames, micros() - start);
+}
+
+// Full-board redraws, the way display.ino paints a game in progress
+static void benchBoardRender()
+{
+  LEDAbstraction panel;
+  panel.Init();
+  Tetris t;
+  t.Seed(SEED);
+  t.Init();
+  for (int i=0; i<40; i++) {
+    t.Drop();
+  }
+
+  const uint32_t count = 200000;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<count; i++) {
+    for (int y=0; y<YSIZE; y++) {
+      for (int x=0; x<XSIZE; x++) {
+	panel.SetLED(x, y, palette[t.GetSquareIndex(x, y)]);
+      }
+    }
+  }
+  report("board renders", count, micros() - start);
+}
+
+// Fading a few pixels on an otherwise busy panel, as when a clock digit
+// changes; the cost should follow the pixels changing, not the panel size
+static void benchFadeSteps(uint16_t changing)
+{
+  LEDAbstraction panel;
+  panel.Init();
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
+      panel.SetLED(x, y, palette[PAL_CLOCK]);
+    }
+  }
+  panel.setFadeMode(true);
+
+  const uint32_t count = 200000;
+  uint32_t steps = 0;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<count; i++) {
+    CRGB color = palette[(i & 1) ? PAL_CLOCK : PAL_EMPTY];
+    for (uint16_t p=0; p<changing; p++) {
+      panel.SetLED(p % DISPLAY_WIDTH, p / DISPLAY_WIDTH, color);
+    }
+    while (panel.fadingCount()) {
+      panel.stepFader();
+      steps++;
+    }
+  }
+  char buf[40];
+  sprintf(buf, "fade steps (%d pixels)", changing);
+  report(buf, steps, micros() - start);
+}
+
+// Scrolling is a step per column plus a draw per frame; the step
+// shouldn't cost more when it's taken more often
+static void benchTextScroll()
+{
+  LEDAbstraction panel;
+  panel.Init();
+  TextScroller scroller(&panel);
+
+  const uint32_t count = 500000;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<count; i++) {
+    if (!scroller.hasData()) {
+      for (const char *p = "Scrolling along "; *p; p++) {
+	scroller.addChar(*p);
+      }
+    }
+    scroller.step();
+  }
+  report("text scroll steps", count, micros() - start);
+
+  const uint32_t draws = 50000;
+  start = micros();
+  for (uint32_t i=0; i<draws; i++) {
+    scroller.step();
+    scroller.draw();
+  }
+  report("text scroll draws", draws, micros() - start);
+}
+
+// Characters from addChar() through to columns scrolled on, which is
+// UTF-8 decoding, the glyph cache and the font; the UTF-8 message keeps
+// the cache busier. Upright glyphs come from the atlas, so should cost
+// the same per column.
+#define ASCII_MESSAGE "The quick brown fox jumps over the lazy dog. "
+#define UTF8_MESSAGE "Jos\xc3\xa9 \xe2\x99\xa5 Zo\xc3\xab: 5\xe2\x82\xac \xc2\xbfQu\xc3\xa9 tal? Stra\xc3\x9f" "e \xe2\x86\x92 "
+
+static void benchTextRender(const char *what, const char *message, uint8_t orientation)
+{
+  LEDAbstraction panel;
+  panel.Init();
+  TextScroller scroller(&panel);
+  scroller.setOrientation(orientation);
+
+  uint32_t chars = 0;
+  for (const char *p = message; *p; p++) {
+    if ((*p & 0xc0) != 0x80)
+      chars++;
+  }
+
+  const uint32_t rounds = 20000;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<rounds; i++) {
+    for (const char *p = message; *p; p++) {
+      scroller.addChar(*p);
+    }
+    while (scroller.step())
+      ;
+  }
+  report(what, chars * rounds, micros() - start);
+  printf("%-28s %10u hits, %u misses\n", "glyph cache", scroller.glyphHits(),
+	 scroller.glyphMisses());
+}
+
+// The 35ms refresh from loop() over a minute of clock face that only
+// changes once, with fading on: only the fade should reach the panel
+static void benchIdleRefresh()
+{
+  LEDAbstraction panel;
+  panel.Init();
+  panel.setFadeMode(true);
+  TetrisClock clock(&panel);
+  clock.setTime(12, 34, 0, 6, 1);
+  while (clock.step())
+    ;
+
+  uint32_t before = FastLED.shows;
+  const uint32_t ticks = 60000 / 35;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<ticks; i++) {
+    panel.Update();
+  }
+  report("idle refreshes", ticks, micros() - start);
+  printf("%-28s %10u shown, %u skipped\n", "idle refresh results",
+	 FastLED.shows - before, panel.skippedShowCount());
+}
+
+int main(int argc, char *argv[])
+{
+  setPaletteTheme(THEME_CLASSIC);
+
+  benchTetrisSteps();
+  benchTetrisRotations();
+  benchTetrisLineClears();
+  benchAutopilot();
+  benchSnakeSteps();
+  benchSnakeLongSteps(64);
+  benchSnakeLongSteps(240);
+  benchSnakeAutopilot();
+  benchClockFrames();
+  benchBoardRender();
+  benchFadeSteps(4);
+  benchFadeSteps(DISPLAY_PIXELS);
+  benchTextScroll();
+  benchTextRender("text chars rendered (ASCII)", ASCII_MESSAGE, FONT_SIDEWAYS);
+  benchTextRender("text chars rendered (UTF-8)", UTF8_MESSAGE, FONT_SIDEWAYS);
+  benchTextRender("upright chars rendered", UTF8_MESSAGE, FONT_UPRIGHT);
+  benchIdleRefresh();
+  return 0;
+}
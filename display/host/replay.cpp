@@ -0,0 +1,168 @@
+// Replays a game recorded by InputLog (pulled off the display with
+// /download?file=/inputlog.bin) at full speed, and checks that it ends
+// on the same board the display did.
+//
+//   replay <log>              replay a log, and time it
+//   replay -r <log> [seed]    record a demo game, played by the autopilot
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <vector>
+
+#include "tetris.h"
+#include "snake.h"
+#include "tetris-autopilot.h"
+#include "GameInput.h"
+#include "InputLog.h"
+
+// Replay at least this long, to get a stable events/sec figure
+#define MINREPLAYMICROS 1000000
+
+static FILE *recordTo = NULL;
+
+static void fileSink(const uint8_t *data, uint16_t len, bool first)
+{
+  fwrite(data, 1, len, recordTo);
+}
+
+static int recordDemo(const char *path, uint32_t seed)
+{
+  recordTo = fopen(path, "wb");
+  if (!recordTo) {
+    perror(path);
+    return 1;
+  }
+
+  Tetris t;
+  TetrisAutopilot pilot(&t);
+  InputLog log;
+  log.setSink(fileSink);
+
+  uint32_t now = 0;
+  t.Seed(seed);
+  t.Init();
+  log.begin(INPUTLOG_TETRIS, seed, now);
+
+  // A few hundred pieces, with a gravity step between moves
+  bool alive = true;
+  for (int piece=0; piece<300 && alive; piece++) {
+    while (!pilot.think(100000))
+      ;
+    char c;
+    do {
+      c = pilot.nextMove();
+      now += 120;
+      log.record(now, c);
+      alive = tetrisInput(&t, c);
+      if (alive && c != ' ') {
+	now += 10;
+	log.record(now, 's');
+	alive = tetrisInput(&t, 's');
+	if (t.changedPieceThisTurn())
+	  break;
+      }
+    } while (alive && c != ' ');
+    pilot.reset();
+  }
+  log.end(now, t.BoardHash());
+  fclose(recordTo);
+
+  printf("recorded %u events, score %u, hash %08x\n",
+	 log.eventCount(), t.score(), t.BoardHash());
+  return 0;
+}
+
+// Returns the number of events applied, or -1 on a malformed log
+static int32_t replayOnce(const std::vector<uint8_t> &data, uint8_t game,
+			  uint32_t seed, uint32_t *gotHash, uint32_t *wantHash)
+{
+  Tetris t;
+  Snake s;
+  if (game == INPUTLOG_TETRIS) {
+    t.Seed(seed);
+    t.Init();
+  } else {
+    s.Seed(seed);
+    s.Init();
+  }
+
+  uint32_t pos = 0;
+  int32_t count = 0;
+  inputLogEvent ev;
+  ev.tick = 0;
+  while (inputLogNextEvent(&data[0], data.size(), &pos, &ev)) {
+    if (ev.input == INPUTLOG_END) {
+      *wantHash = ev.hash;
+      *gotHash = (game == INPUTLOG_TETRIS) ? t.BoardHash() : s.BoardHash();
+      return count;
+    }
+    if (game == INPUTLOG_TETRIS) {
+      tetrisInput(&t, ev.input);
+    } else {
+      snakeInput(&s, ev.input);
+    }
+    count++;
+  }
+  return -1;
+}
+
+static int replay(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  int c;
+  while ((c = fgetc(f)) != EOF) {
+    data.push_back(c);
+  }
+  fclose(f);
+
+  uint8_t game;
+  uint32_t seed;
+  if (!inputLogParseHeader(&data[0], data.size(), &game, &seed) ||
+      (game != INPUTLOG_TETRIS && game != INPUTLOG_SNAKE)) {
+    fprintf(stderr, "%s: not an input log\n", path);
+    return 1;
+  }
+
+  uint32_t gotHash = 0, wantHash = 0;
+  uint32_t runs = 0;
+  uint64_t events = 0;
+  uint32_t start = micros();
+  do {
+    int32_t n = replayOnce(data, game, seed, &gotHash, &wantHash);
+    if (n < 0) {
+      fprintf(stderr, "%s: truncated log (no trailer)\n", path);
+      return 1;
+    }
+    events += n;
+    runs++;
+  } while (micros() - start < MINREPLAYMICROS);
+  uint32_t elapsed = micros() - start;
+
+  printf("%s: %s game, seed %u, %u events\n", path,
+	 game == INPUTLOG_TETRIS ? "tetris" : "snake", seed, (uint32_t)(events / runs));
+  printf("replayed %u times: %.0f events/sec\n", runs, events * 1000000.0 / elapsed);
+  if (gotHash != wantHash) {
+    printf("FAIL: board hash %08x, expected %08x\n", gotHash, wantHash);
+    return 1;
+  }
+  printf("ok: board hash %08x matches\n", gotHash);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc >= 3 && !strcmp(argv[1], "-r")) {
+    return recordDemo(argv[2], argc > 3 ? strtoul(argv[3], NULL, 0) : 8267);
+  }
+  if (argc == 2) {
+    return replay(argv[1]);
+  }
+
+  fprintf(stderr, "usage: %s <log>\n       %s -r <log> [seed]\n", argv[0], argv[0]);
+  return 1;
+}
@@ -0,0 +1,115 @@
+// Checks the text column ring: columns come back out in order across
+// many wraps, colors apply from the column they were set at, and a long
+// message renders in one go instead of a character per scroll step.
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include "RingPixels.h"
+#include "TextScroller.h"
+#include "Palette.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static void checkOrder()
+{
+  RingPixels r(PAL_TEXT);
+  uint32_t added = 0, taken = 0;
+  bool inOrder = true;
+  for (int round=0; round<50; round++) {
+    while (!r.isFull()) {
+      r.addColumn((uint8_t) added++);
+    }
+    check(!r.addColumn(0), "a full ring refuses columns");
+    for (int i=0; i<100; i++) {
+      uint8_t bits, color;
+      r.consumeColumn(&bits, &color);
+      inOrder = inOrder && bits == (uint8_t) taken++ && color == PAL_TEXT;
+    }
+  }
+  check(inOrder, "columns come out in order");
+  check(r.freeSpace() == 100, "free space tracks consumption");
+}
+
+static void checkColors()
+{
+  RingPixels r(PAL_TEXT);
+  uint8_t want[RINGPIXELS_COLUMNS];
+  uint16_t n = 0;
+  for (int run=0; run<6; run++) {
+    uint8_t color = (run & 1) ? PAL_CLOCK : PAL_FOOD;
+    check(r.setColor(color), "color change accepted");
+    for (int i=0; i<run + 1; i++) {
+      r.addColumn(0xFF);
+      want[n++] = color;
+    }
+  }
+  bool right = true;
+  for (uint16_t i=0; i<n; i++) {
+    uint8_t bits, color;
+    r.consumeColumn(&bits, &color);
+    right = right && color == want[i];
+  }
+  check(right, "each column keeps the color it was added in");
+
+  // Over and over, so the runs wrap too
+  bool wrapped = true;
+  for (int i=0; i<1000; i++) {
+    uint8_t c = (i % 3) + PAL_I;
+    r.setColor(c);
+    r.addColumn(1);
+    uint8_t bits, color;
+    r.consumeColumn(&bits, &color);
+    wrapped = wrapped && color == c;
+  }
+  check(wrapped, "color runs wrap");
+}
+
+static void checkScroller()
+{
+  LEDAbstraction panel;
+  panel.Init();
+  TextScroller scroller(&panel);
+
+  // 40 characters is over 200 columns: more than six 32-row screens
+  const char *message = "A long message that fills several screen";
+  uint16_t dropped = 0, columns = 0;
+  for (const char *p = message; *p; p++) {
+    if (!scroller.addChar(*p))
+      dropped++;
+    fontGlyph g;
+    findGlyph(*p, &g);
+    columns += g.width + (p > message && !kernedPair(p[-1], *p));
+  }
+  check(dropped == 0, "nothing dropped");
+
+  uint16_t steps = 0;
+  while (scroller.step())
+    steps++;
+  check(steps == columns, "every column scrolls on");
+  check(!scroller.hasData(), "all scrolled on");
+}
+
+int main(int argc, char *argv[])
+{
+  setPaletteTheme(THEME_CLASSIC);
+
+  checkOrder();
+  checkColors();
+  checkScroller();
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
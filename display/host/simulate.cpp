@@ -0,0 +1,237 @@
+// Runs the text scroller, the Tetris clock or a game against the
+// simulated millis() clock, refreshing the panel every 35ms the way
+// loop() does, and sends every frame that's shown to a frame sink.
+// Reports the simulated frame rate and what each frame cost on this
+// host (leaving out the time spent writing frames).
+//
+//   simulate [-raw file | -ppm prefix | -ansi] [-seconds n] [-step ms] [-upright] mode [args]
+//
+// mode is one of
+//   text "message"  (-step sets the scroll speed, -upright turns the glyphs)
+//   clock hh:mm
+//   tetris
+//   snake
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "LEDAbstraction.h"
+#include "TextScroller.h"
+#include "tetris.h"
+#include "snake.h"
+#include "tetris-clock.h"
+#include "tetris-autopilot.h"
+#include "snake-autopilot.h"
+#include "GameInput.h"
+#include "Palette.h"
+#include "FrameSink.h"
+
+#define SEED 8267
+
+#define PASS_MILLIS 5 // simulated time per pass through loop()
+#define REFRESH_MILLIS 35
+#define TETRIS_MOVE_MILLIS 120
+#define TETRIS_STEP_MILLIS 500
+#define SNAKE_STEP_MILLIS 80
+
+static LEDAbstraction panel;
+
+// Each mode gets called once per pass and returns false when it's done
+typedef bool (*passFunction)(uint32_t now);
+
+static TextScroller *scroller;
+static uint32_t nextText;
+static uint32_t textStepMillis = TEXT_SCROLL_MILLIS;
+static uint8_t textOrientation = FONT_SIDEWAYS;
+
+static bool textPass(uint32_t now)
+{
+  if (now >= nextText) {
+    if (!scroller->step() && !scroller->hasData())
+      return false;
+    nextText = now + textStepMillis;
+  }
+  return true;
+}
+
+static TetrisClock *clockFace;
+static uint32_t nextClock;
+
+static bool clockPass(uint32_t now)
+{
+  if (now >= nextClock) {
+    if (!clockFace->step())
+      return false;
+    nextClock = now + clockFace->frameDelay();
+  }
+  return true;
+}
+
+template<class Engine> static void drawBoard(Engine *e)
+{
+  for (int y=0; y<YSIZE; y++) {
+    for (int x=0; x<XSIZE; x++) {
+      panel.SetLED(x, y, palette[e->GetSquareIndex(x, y)]);
+    }
+  }
+}
+
+static Tetris *tetris;
+static TetrisAutopilot *tetrisPilot;
+static uint32_t nextMove, nextStep;
+
+static bool tetrisPass(uint32_t now)
+{
+  tetrisPilot->think(2000);
+  bool alive = true;
+  if (now >= nextMove) {
+    char c = tetrisPilot->nextMove();
+    if (c) {
+      alive = tetrisInput(tetris, c);
+      if (c == ' ')
+	tetrisPilot->reset();
+      nextMove = now + TETRIS_MOVE_MILLIS;
+    }
+  }
+  if (alive && now >= nextStep) {
+    alive = tetris->Step();
+    if (tetris->changedPieceThisTurn())
+      tetrisPilot->reset();
+    nextStep = now + TETRIS_STEP_MILLIS;
+  }
+  drawBoard(tetris);
+  return alive;
+}
+
+static Snake *snake;
+static SnakeAutopilot *snakePilot;
+
+static bool snakePass(uint32_t now)
+{
+  if (now >= nextStep) {
+    char c = snakePilot->nextMove();
+    if (c)
+      snakeInput(snake, c);
+    if (!snake->Step())
+      return false;
+    nextStep = now + SNAKE_STEP_MILLIS;
+  }
+  drawBoard(snake);
+  return true;
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: simulate [-raw file | -ppm prefix | -ansi] [-seconds n] [-step ms] [-upright] "
+	  "text \"message\" | clock hh:mm | tetris | snake\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+  int sinkKind = -1;
+  const char *sinkWhere = NULL;
+  uint32_t limitMillis = 0;
+
+  int i = 1;
+  for (; i<argc && argv[i][0] == '-'; i++) {
+    if (!strcmp(argv[i], "-raw") && i+1 < argc) {
+      sinkKind = FRAMESINK_RAW;
+      sinkWhere = argv[++i];
+    } else if (!strcmp(argv[i], "-ppm") && i+1 < argc) {
+      sinkKind = FRAMESINK_PPM;
+      sinkWhere = argv[++i];
+    } else if (!strcmp(argv[i], "-ansi")) {
+      sinkKind = FRAMESINK_ANSI;
+      sinkWhere = "-";
+    } else if (!strcmp(argv[i], "-step") && i+1 < argc) {
+      textStepMillis = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-upright")) {
+      textOrientation = FONT_UPRIGHT;
+    } else if (!strcmp(argv[i], "-seconds") && i+1 < argc) {
+      limitMillis = atoi(argv[++i]) * 1000;
+    } else {
+      usage();
+    }
+  }
+  if (i >= argc)
+    usage();
+  const char *mode = argv[i++];
+
+  setPaletteTheme(THEME_CLASSIC);
+  randomSeed(SEED);
+  panel.Init();
+  panel.clear();
+
+  passFunction pass;
+  if (!strcmp(mode, "text") && i < argc) {
+    scroller = new TextScroller(&panel);
+    scroller->setOrientation(textOrientation);
+    for (const char *p = argv[i]; *p; p++) {
+      scroller->addChar(*p);
+    }
+    // Scroll the last of it all the way off
+    for (int n=0; n<DISPLAY_HEIGHT / (FONT_SPACE_WIDTH + 1) + 1; n++) {
+      scroller->addChar(' ');
+    }
+    pass = textPass;
+  } else if (!strcmp(mode, "clock") && i < argc) {
+    int h, m;
+    if (sscanf(argv[i], "%d:%d", &h, &m) != 2)
+      usage();
+    clockFace = new TetrisClock(&panel);
+    clockFace->setTime(h, m, 0, 6, 1);
+    pass = clockPass;
+  } else if (!strcmp(mode, "tetris")) {
+    tetris = new Tetris();
+    tetris->Seed(SEED);
+    tetris->Init();
+    tetrisPilot = new TetrisAutopilot(tetris);
+    pass = tetrisPass;
+    if (!limitMillis)
+      limitMillis = 60 * 1000;
+  } else if (!strcmp(mode, "snake")) {
+    snake = new Snake();
+    snake->Seed(SEED);
+    snake->Init();
+    snakePilot = new SnakeAutopilot(snake);
+    pass = snakePass;
+  } else {
+    usage();
+  }
+
+  if (sinkKind >= 0 && !frameSinkOpen(sinkKind, sinkWhere)) {
+    fprintf(stderr, "can't open %s\n", sinkWhere);
+    return 1;
+  }
+
+  uint32_t showsBefore = panel.showCount();
+  uint32_t hostMicros = 0;
+  uint32_t nextRefresh = 0;
+  hostSetMillis(0);
+  while (1) {
+    uint32_t now = millis();
+    uint32_t start = micros();
+    bool running = pass(now);
+    if (now >= nextRefresh || !running) {
+      if (scroller)
+	scroller->draw();
+      panel.Update();
+      nextRefresh = now + REFRESH_MILLIS;
+    }
+    hostMicros += micros() - start;
+    if (!running || (limitMillis && now >= limitMillis))
+      break;
+    hostAdvanceMillis(PASS_MILLIS);
+  }
+  frameSinkClose();
+
+  uint32_t elapsed = millis();
+  uint32_t shows = panel.showCount() - showsBefore;
+  hostMicros -= frameSinkMicros();
+  fprintf(stderr, "%s: %u frames in %.2f simulated s (%.1f frames/s), %.2f us per frame on this host\n",
+	  mode, shows, elapsed / 1000.0, elapsed ? shows * 1000.0 / elapsed : 0.0,
+	  shows ? (double) hostMicros / shows : 0.0);
+  return 0;
+}
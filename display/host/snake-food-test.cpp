@@ -0,0 +1,117 @@
+// Checks that Snake's free-cell index stays consistent with the board,
+// and that food placement takes the same time on a nearly full board
+// as on an empty one.
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include "snake.h"
+
+#define SEED 8267
+#define PLACEMENTS 2000000
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static bool indexMatchesBoard(Snake *s)
+{
+  uint16_t empty = 0;
+  for (int y=0; y<YSIZE; y++) {
+    for (int x=0; x<XSIZE; x++) {
+      uint8_t cell = y * XSIZE + x;
+      if (s->board[y][x])
+	continue;
+      empty++;
+      if (s->freePos[cell] >= s->numFreeCells ||
+	  s->freeCells[s->freePos[cell]] != cell)
+	return false;
+    }
+  }
+  return empty == s->numFreeCells;
+}
+
+// Fill the board to (about) percent full, then time placing food and
+// taking it away again. Returns nanoseconds per placement.
+static double timePlacements(int percent)
+{
+  Snake s;
+  s.Seed(SEED);
+  s.Init();
+
+  uint16_t fill = SNAKE_MAXLEN * percent / 100;
+  while (s.numFreeCells > SNAKE_MAXLEN - fill) {
+    uint8_t cell = s.freeCells[s.rng.lessThan(s.numFreeCells)];
+    s.SetSquare(cell % XSIZE, cell / XSIZE, 'S');
+  }
+  check(indexMatchesBoard(&s), "free-cell index after filling");
+
+  uint16_t freeBefore = s.numFreeCells;
+  uint32_t missed = 0;
+  uint32_t start = micros();
+  for (uint32_t i=0; i<PLACEMENTS; i++) {
+    if (!s.AddRandomFood()) {
+      missed++;
+      continue;
+    }
+    s.SetSquare(s.lastFood.x, s.lastFood.y, 0);
+  }
+  uint32_t elapsed = micros() - start;
+
+  check(missed == 0, "every placement found a free square");
+  check(s.numFreeCells == freeBefore, "free-cell count restored");
+  check(indexMatchesBoard(&s), "free-cell index after placements");
+
+  double ns = elapsed * 1000.0 / PLACEMENTS;
+  printf("%3d%% full (%3u free): %6.1f ns per placement\n",
+	 percent, freeBefore, ns);
+  return ns;
+}
+
+// Play a long game with random turns, checking the index as we go
+static void checkDuringPlay()
+{
+  Snake s;
+  s.Seed(SEED);
+  s.Init();
+  GameRandom r;
+  r.seed(SEED);
+
+  for (uint32_t i=0; i<200000; i++) {
+    uint16_t t = r.lessThan(8);
+    if (t == 0) s.TurnLeft();
+    else if (t == 1) s.TurnRight();
+    if (!s.Step()) {
+      s.Init();
+    }
+    if ((i % 97) == 0 && !indexMatchesBoard(&s)) {
+      check(false, "free-cell index during play");
+      return;
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  checkDuringPlay();
+
+  double emptyNs = timePlacements(10);
+  double fullNs = timePlacements(95);
+
+  // Constant time: a 95% full board shouldn't be meaningfully slower
+  // than a nearly empty one (with plenty of slack for a noisy host)
+  check(fullNs < emptyNs * 3 + 20, "placement latency independent of fill");
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef __HOST_ARDUINO_H
+#define __HOST_ARDUINO_H
+
+// Just enough of the Arduino core to build the game engines on a Linux
+// host. millis() runs off a simulated clock that the harness advances;
+// micros() is the real monotonic clock, for timing budgets.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P memcpy
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void yield();
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// Host-only: drive the simulated millis() clock
+void hostSetMillis(uint32_t ms);
+void hostAdvanceMillis(uint32_t ms);
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef __HOST_FASTLED_H
+#define __HOST_FASTLED_H
+
+// A minimal stand-in for FastLED: the color types and math that the
+// sketch uses, and a FastLED object whose show() only counts frames.
+
+#include "Arduino.h"
+
+typedef uint8_t fract8;
+
+enum EOrder { RGB = 0012, GRB = 0102 };
+
+enum HSVHue {
+  HUE_RED = 0,
+  HUE_ORANGE = 32,
+  HUE_YELLOW = 64,
+  HUE_GREEN = 96,
+  HUE_AQUA = 128,
+  HUE_BLUE = 160,
+  HUE_PURPLE = 192,
+  HUE_PINK = 224
+};
+
+static inline uint8_t scale8(uint8_t i, fract8 scale)
+{
+  return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+static inline uint8_t scale8_video(uint8_t i, fract8 scale)
+{
+  return (((int)i * (int)scale) >> 8) + ((i && scale) ? 1 : 0);
+}
+
+struct CHSV {
+  union {
+    struct {
+      union { uint8_t hue; uint8_t h; };
+      union { uint8_t saturation; uint8_t sat; uint8_t s; };
+      union { uint8_t value; uint8_t val; uint8_t v; };
+    };
+    uint8_t raw[3];
+  };
+
+  CHSV() : h(0), s(0), v(0) { }
+  CHSV(uint8_t ih, uint8_t is, uint8_t iv) : h(ih), s(is), v(iv) { }
+};
+
+struct CRGB;
+void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb);
+
+struct CRGB {
+  union {
+    struct {
+      union { uint8_t r; uint8_t red; };
+      union { uint8_t g; uint8_t green; };
+      union { uint8_t b; uint8_t blue; };
+    };
+    uint8_t raw[3];
+  };
+
+  typedef enum {
+    Black = 0x000000,
+    Blue = 0x0000FF,
+    Brown = 0xA52A2A,
+    Green = 0x008000,
+    Red = 0xFF0000,
+    White = 0xFFFFFF
+  } HTMLColorCode;
+
+  CRGB() : r(0), g(0), b(0) { }
+  CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) { }
+  CRGB(uint32_t colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) { }
+  CRGB(HTMLColorCode colorcode) : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF) { }
+  CRGB(const CHSV &rhs) { hsv2rgb_rainbow(rhs, *this); }
+
+  CRGB &operator=(const CHSV &rhs) { hsv2rgb_rainbow(rhs, *this); return *this; }
+
+  CRGB &nscale8_video(uint8_t scaledown) {
+    r = scale8_video(r, scaledown);
+    g = scale8_video(g, scaledown);
+    b = scale8_video(b, scaledown);
+    return *this;
+  }
+  CRGB &nscale8(uint8_t scaledown) {
+    r = scale8(r, scaledown);
+    g = scale8(g, scaledown);
+    b = scale8(b, scaledown);
+    return *this;
+  }
+};
+
+inline bool operator==(const CRGB &lhs, const CRGB &rhs)
+{
+  return lhs.r == rhs.r && lhs.g == rhs.g && lhs.b == rhs.b;
+}
+
+inline bool operator!=(const CRGB &lhs, const CRGB &rhs)
+{
+  return !(lhs == rhs);
+}
+
+CRGB &nblend(CRGB &existing, const CRGB &overlay, fract8 amountOfOverlay);
+void nblend(CRGB *existing, const CRGB *overlay, uint16_t count, fract8 amountOfOverlay);
+
+template<uint8_t DATA_PIN, EOrder RGB_ORDER> class WS2812 { };
+
+class CFastLED {
+ public:
+  CFastLED() : leds(0), numLeds(0), brightness(255), shows(0), showHook(0) { }
+
+  template<template<uint8_t DATA_PIN, EOrder RGB_ORDER> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+  void addLeds(CRGB *data, int count) {
+    leds = data;
+    numLeds = count;
+  }
+
+  void setBrightness(uint8_t scale) { brightness = scale; }
+  uint8_t getBrightness() { return brightness; }
+
+  void show();
+
+  // Host-only introspection
+  CRGB *leds;
+  int numLeds;
+  uint8_t brightness;
+  uint32_t shows;
+
+  // Host-only: called with the chain on every show (see FrameSink.h)
+  void (*showHook)(const CRGB *leds, int count);
+};
+
+extern CFastLED FastLED;
+
+#endif
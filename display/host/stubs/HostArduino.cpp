@@ -0,0 +1,120 @@
+#include "Arduino.h"
+#include "FastLED.h"
+
+#include <time.h>
+
+static uint32_t simulatedMillis = 0;
+
+uint32_t millis()
+{
+  return simulatedMillis;
+}
+
+uint32_t micros()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+void delay(uint32_t ms)
+{
+  simulatedMillis += ms;
+}
+
+void yield()
+{
+}
+
+void hostSetMillis(uint32_t ms)
+{
+  simulatedMillis = ms;
+}
+
+void hostAdvanceMillis(uint32_t ms)
+{
+  simulatedMillis += ms;
+}
+
+// A fixed LCG rather than libc's rand(), so that a given seed replays the
+// same games on every host.
+static uint32_t randomState = 1;
+
+void randomSeed(unsigned long seed)
+{
+  if (seed != 0)
+    randomState = seed;
+}
+
+long random(long howbig)
+{
+  if (howbig <= 0)
+    return 0;
+  randomState = randomState * 1103515245 + 12345;
+  return (randomState >> 8) % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+  if (howsmall >= howbig)
+    return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+// The sketch's RTC-memory watchdog breadcrumbs; nothing to do here
+void WLOG(uint8_t x)
+{
+}
+
+CFastLED FastLED;
+
+void CFastLED::show()
+{
+  shows++;
+  if (showHook)
+    showHook(leds, numLeds);
+}
+
+// Not FastLED's exact rainbow mapping, but close enough to tell the
+// pieces apart in a frame dump.
+void hsv2rgb_rainbow(const CHSV &hsv, CRGB &rgb)
+{
+  uint8_t region = hsv.h / 43;
+  uint8_t remainder = (hsv.h - (region * 43)) * 6;
+
+  uint8_t p = scale8(hsv.v, 255 - hsv.s);
+  uint8_t q = scale8(hsv.v, 255 - scale8(hsv.s, remainder));
+  uint8_t t = scale8(hsv.v, 255 - scale8(hsv.s, 255 - remainder));
+
+  switch (region) {
+  case 0: rgb = CRGB(hsv.v, t, p); break;
+  case 1: rgb = CRGB(q, hsv.v, p); break;
+  case 2: rgb = CRGB(p, hsv.v, t); break;
+  case 3: rgb = CRGB(p, q, hsv.v); break;
+  case 4: rgb = CRGB(t, p, hsv.v); break;
+  default: rgb = CRGB(hsv.v, p, q); break;
+  }
+}
+
+CRGB &nblend(CRGB &existing, const CRGB &overlay, fract8 amountOfOverlay)
+{
+  if (amountOfOverlay == 0)
+    return existing;
+  if (amountOfOverlay == 255) {
+    existing = overlay;
+    return existing;
+  }
+
+  fract8 amountOfKeep = 255 - amountOfOverlay;
+  existing.r = scale8(existing.r, amountOfKeep) + scale8(overlay.r, amountOfOverlay);
+  existing.g = scale8(existing.g, amountOfKeep) + scale8(overlay.g, amountOfOverlay);
+  existing.b = scale8(existing.b, amountOfKeep) + scale8(overlay.b, amountOfOverlay);
+  return existing;
+}
+
+void nblend(CRGB *existing, const CRGB *overlay, uint16_t count, fract8 amountOfOverlay)
+{
+  for (uint16_t i=0; i<count; i++) {
+    nblend(existing[i], overlay[i], amountOfOverlay);
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef __HOST_RINGBUFFER_H
+#define __HOST_RINGBUFFER_H
+
+// The parts of the RingBuffer library the sketch uses, for the host build
+
+#include <stdint.h>
+#include <stdlib.h>
+
+class RingBuffer {
+ public:
+  RingBuffer(int length) : max(length), ptr(0), fill(0) {
+    buffer = (uint8_t *)malloc(length);
+  }
+  ~RingBuffer() { free(buffer); }
+
+  void clear() { fill = 0; }
+  bool isFull() { return fill == max; }
+  bool hasData() { return fill != 0; }
+
+  bool addByte(uint8_t b) {
+    if (fill == max)
+      return false;
+    buffer[(ptr + fill) % max] = b;
+    fill++;
+    return true;
+  }
+
+  uint8_t consumeByte() {
+    if (fill == 0)
+      return 0;
+    uint8_t b = buffer[ptr];
+    ptr = (ptr + 1) % max;
+    fill--;
+    return b;
+  }
+
+ private:
+  uint8_t *buffer;
+  int max;
+  int ptr;
+  int fill;
+};
+
+#endif
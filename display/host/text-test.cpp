@@ -0,0 +1,212 @@
+// Checks the text pipeline: UTF-8 decoding, including what it does with
+// malformed input, the proportional font's coverage and kerning, the
+// upright atlas, the glyph cache, and that the scroller counts what it
+// has to drop.
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include "Utf8Decoder.h"
+#include "GlyphTable.h"
+#include "GlyphCache.h"
+#include "TextScroller.h"
+#include "Palette.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+// Decodes s, returning how many code points came out
+static int decodeAll(const char *s, uint16_t *out)
+{
+  Utf8Decoder d;
+  int n = 0;
+  for (const char *p = s; *p; p++) {
+    n += d.decode(*p, &out[n]);
+  }
+  return n;
+}
+
+static void checkDecoder()
+{
+  uint16_t cp[16];
+
+  check(decodeAll("Az", cp) == 2 && cp[0] == 'A' && cp[1] == 'z', "ASCII passes through");
+  check(decodeAll("\xc3\xa9t\xc3\xa9", cp) == 3 && cp[0] == 0xe9 && cp[1] == 't' &&
+	cp[2] == 0xe9, "two byte sequences");
+  check(decodeAll("\xe2\x82\xac\xe2\x99\xa5", cp) == 2 && cp[0] == 0x20ac &&
+	cp[1] == 0x2665, "three byte sequences");
+  check(decodeAll("\xf0\x9f\x98\x80", cp) == 1 && cp[0] == UTF8_REPLACEMENT,
+	"past the BMP is replaced");
+  check(decodeAll("\xc0\xaf", cp) == 2 && cp[0] == UTF8_REPLACEMENT &&
+	cp[1] == UTF8_REPLACEMENT, "invalid lead bytes are replaced");
+  check(decodeAll("\xe0\x80\xaf", cp) == 1 && cp[0] == UTF8_REPLACEMENT,
+	"overlong forms are replaced");
+  check(decodeAll("\xed\xa0\x80", cp) == 1 && cp[0] == UTF8_REPLACEMENT,
+	"surrogates are replaced");
+  check(decodeAll("\x80x", cp) == 2 && cp[0] == UTF8_REPLACEMENT && cp[1] == 'x',
+	"stray continuation bytes are replaced");
+  check(decodeAll("\xe2\x82x\xc3\xa9", cp) == 3 && cp[0] == UTF8_REPLACEMENT &&
+	cp[1] == 'x' && cp[2] == 0xe9, "a cut short sequence doesn't eat what follows");
+}
+
+static bool sameColumns(const fontGlyph &a, const fontGlyph &b)
+{
+  return a.width == b.width && !memcmp(a.columns, b.columns, a.width);
+}
+
+static void checkFont()
+{
+  fontGlyph e, eAcute, E, EAcute, g;
+
+  bool asciiOk = true;
+  for (uint16_t c=FONT_FIRST_CHAR; c<=FONT_LAST_CHAR; c++) {
+    asciiOk = asciiOk && findGlyph(c, &g) && g.codepoint == c &&
+      g.width > 0 && g.width <= FONT_MAX_WIDTH;
+  }
+  check(asciiOk, "all of printable ASCII is covered");
+
+  findGlyph('i', &g);
+  check(g.width < FONT_MAX_WIDTH, "narrow letters are narrow");
+  findGlyph(' ', &g);
+  check(g.width == FONT_SPACE_WIDTH && !g.columns[0], "space is blank");
+
+  check(findGlyph('e', &e) && findGlyph(0xe9, &eAcute) && !sameColumns(e, eAcute),
+	"lower case accents are drawn");
+  check((eAcute.columns[2] & 0x03) && (eAcute.columns[2] & ~0x03) == (e.columns[2] & ~0x03),
+	"the accent sits above the letter");
+  check(findGlyph('E', &E) && findGlyph(0xc9, &EAcute) && sameColumns(E, EAcute),
+	"capitals fall back to the base letter");
+  check(findGlyph(0x20ac, &g) && g.codepoint == 0x20ac, "symbols are covered");
+
+  check(!findGlyph(0x7f, &g) && !findGlyph(0x1f, &g) && !findGlyph(0x4e2d, &g) &&
+	!findGlyph(UTF8_REPLACEMENT, &g), "what isn't covered is reported");
+
+  check(kernedPair('T', 'o') && !kernedPair('o', 'T') && !kernedPair('T', 0xf3),
+	"kerning pairs");
+}
+
+static void checkCache()
+{
+  GlyphCache cache;
+
+  const glyphSlices *q = cache.lookup(0x4e2d);
+  glyphSlices replacement;
+  findSlices(FONT_REPLACEMENT, FONT_SIDEWAYS, &replacement);
+  check(q && q->count == replacement.count &&
+	!memcmp(q->slices, replacement.slices, q->count),
+	"unknown code points get the replacement glyph");
+
+  cache.lookup('a');
+  cache.lookup('a');
+  cache.lookup(0x4e2d);
+  check(cache.hits() == 2 && cache.misses() == 2, "repeats are hits");
+
+  // Fill it up, touching 'a' as we go; the unknown one should go first
+  for (uint16_t c='A'; c<'A' + GLYPH_CACHE_SIZE - 1; c++) {
+    cache.lookup(c);
+    cache.lookup('a');
+  }
+  uint32_t misses = cache.misses();
+  cache.lookup('a');
+  check(cache.misses() == misses, "recently used glyphs stay");
+  cache.lookup(0x4e2d);
+  check(cache.misses() == misses + 1, "least recently used glyphs go");
+}
+
+// The atlas should be the sideways glyph turned a quarter turn, centred
+// across the panel
+static void checkUpright()
+{
+  bool turned = true;
+  for (uint16_t c=FONT_FIRST_CHAR; c<=0x2665; c++) {
+    fontGlyph g;
+    glyphSlices s;
+    if (!findGlyph(c, &g))
+      continue;
+    turned = turned && findSlices(c, FONT_UPRIGHT, &s) &&
+      s.count >= CHAR_HEIGHT && s.count <= FONT_UPRIGHT_HEIGHT;
+    uint8_t offset = (FONT_UPRIGHT_HEIGHT - g.width) / 2;
+    for (uint8_t y=0; y<FONT_UPRIGHT_HEIGHT; y++) {
+      for (uint8_t x=0; x<g.width; x++) {
+	bool sideways = (g.columns[x] >> y) & 1;
+	bool upright = y < s.count && (s.slices[y] & (0x80 >> (offset + x)));
+	turned = turned && sideways == upright;
+      }
+    }
+  }
+  check(turned, "upright glyphs match the sideways ones");
+
+  glyphSlices s;
+  findSlices(0xe7, FONT_UPRIGHT, &s);
+  check(s.count == FONT_UPRIGHT_HEIGHT, "the cedilla's row is sent");
+  findSlices('c', FONT_UPRIGHT, &s);
+  check(s.count == CHAR_HEIGHT, "other glyphs stop at the baseline");
+
+  // Upright glyphs stack with a row between them, kerned pairs or not
+  LEDAbstraction panel;
+  panel.Init();
+  TextScroller scroller(&panel);
+  scroller.addChar('x');
+  scroller.setOrientation(FONT_UPRIGHT);
+  check(!scroller.hasData() && scroller.orientation() == FONT_UPRIGHT,
+	"turning the text starts over");
+  for (const char *p = "To"; *p; p++) {
+    scroller.addChar(*p);
+  }
+  uint16_t steps = 0;
+  while (scroller.step())
+    steps++;
+  check(steps == 2 * CHAR_HEIGHT + 1, "upright glyphs stack down the panel");
+}
+
+static void checkScroller()
+{
+  LEDAbstraction panel;
+  panel.Init();
+  TextScroller scroller(&panel);
+
+  // Bytes past the font, and a UTF-8 message, render without trouble
+  const char *message = "\x7f\xff Caf\xc3\xa9 \xe2\x82\xac" "5 \xe2\x99\xa5";
+  for (const char *p = message; *p; p++) {
+    scroller.addChar(*p);
+  }
+  uint16_t steps = 0;
+  while (scroller.step())
+    steps++;
+  check(steps > 0 && !scroller.hasData(), "UTF-8 text scrolls on");
+  check(scroller.droppedBytes() == 0, "nothing dropped");
+
+  // Far more than fits is counted, not lost silently
+  const uint16_t sent = RINGPIXELS_COLUMNS + BACKINGTEXTSIZE;
+  uint16_t refused = 0;
+  for (uint16_t i=0; i<sent; i++) {
+    if (!scroller.addChar('W'))
+      refused++;
+  }
+  check(refused > 0 && scroller.droppedBytes() == refused, "drops are counted");
+}
+
+int main(int argc, char *argv[])
+{
+  setPaletteTheme(THEME_CLASSIC);
+
+  checkDecoder();
+  checkFont();
+  checkCache();
+  checkUpright();
+  checkScroller();
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
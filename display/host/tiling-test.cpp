@@ -0,0 +1,112 @@
+// Checks the panel layout selected by PANEL_LAYOUT: every pixel of the
+// display lands on its own LED, inside its tile's stretch of the chain,
+// and walking along the chain within a tile only ever steps to a
+// neighboring pixel (that is, it follows the serpentine wiring). Also
+// reports what the layout costs in memory and show time.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "LEDAbstraction.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  printf("%d panel(s) of %dx%d, display %dx%d, %d LEDs\n",
+	 PANEL_TILE_COUNT, PANEL_WIDTH, PANEL_HEIGHT,
+	 DISPLAY_WIDTH, DISPLAY_HEIGHT, NUM_LEDS);
+  printf("  %u bytes of frame buffers, %u bytes of map in flash\n",
+	 (unsigned) LED_BUFFER_BYTES, (unsigned) sizeof(panelMap));
+  printf("  %lu us per show (%.0f shows/sec at most)\n",
+	 (unsigned long) PANEL_SHOW_MICROS, 1000000.0 / PANEL_SHOW_MICROS);
+
+  // Where each LED is on the display
+  static int16_t ledX[NUM_LEDS + 1];
+  static int16_t ledY[NUM_LEDS + 1];
+  for (uint16_t i=0; i<=NUM_LEDS; i++) {
+    ledX[i] = -1;
+  }
+
+  uint16_t covered = 0;
+  for (uint8_t y=0; y<DISPLAY_HEIGHT; y++) {
+    for (uint8_t x=0; x<DISPLAY_WIDTH; x++) {
+      uint16_t i = panelIndex(x, y);
+      uint8_t t = tileAt(x, y);
+      if (t == PANEL_TILE_COUNT) {
+	check(i == PANEL_OFFSCREEN, "uncovered pixel goes offscreen");
+	continue;
+      }
+      check(i / PANEL_PIXELS == t, "pixel is in its tile's part of the chain");
+      check(i < NUM_LEDS && ledX[i] == -1, "each LED belongs to one pixel");
+      ledX[i] = x;
+      ledY[i] = y;
+      covered++;
+    }
+  }
+  check(covered == NUM_LEDS, "every LED on the chain is used");
+
+  for (uint16_t i=0; i+1<NUM_LEDS; i++) {
+    if ((i + 1) % PANEL_PIXELS == 0)
+      continue; // on to the next panel
+    int dx = abs(ledX[i] - ledX[i+1]);
+    int dy = abs(ledY[i] - ledY[i+1]);
+    if (dx + dy != 1) {
+      printf("LEDs %d and %d are at (%d,%d) and (%d,%d)\n", i, i+1,
+	     ledX[i], ledY[i], ledX[i+1], ledY[i+1]);
+      check(false, "the chain only steps between neighbors");
+      break;
+    }
+  }
+
+  // And through the real frame buffer: lighting one pixel lights the
+  // LED the map says, and nothing else
+  LEDAbstraction panel;
+  panel.Init();
+  bool routed = true;
+  for (uint8_t y=0; y<DISPLAY_HEIGHT && routed; y+=3) {
+    for (uint8_t x=0; x<DISPLAY_WIDTH && routed; x+=3) {
+      panel.clear();
+      panel.SetLED(x, y, CRGB::White);
+      panel.Update();
+      uint16_t lit = 0;
+      for (uint16_t i=0; i<FastLED.numLeds; i++) {
+	if (FastLED.leds[i] != CRGB(0, 0, 0))
+	  lit++;
+      }
+      uint16_t want = panelIndex(x, y);
+      routed = (lit == 1 && FastLED.leds[want] == CRGB(CRGB::White));
+    }
+  }
+  check(FastLED.numLeds == NUM_LEDS, "the whole chain is handed to FastLED");
+  check(routed, "SetLED() lights the mapped LED");
+
+  // How long a full redraw takes through the map
+  const uint32_t frames = 20000;
+  uint32_t start = micros();
+  for (uint32_t f=0; f<frames; f++) {
+    for (uint8_t y=0; y<DISPLAY_HEIGHT; y++) {
+      for (uint8_t x=0; x<DISPLAY_WIDTH; x++) {
+	panel.SetLED(x, y, CRGB(f, x, y));
+      }
+    }
+  }
+  uint32_t elapsed = micros() - start;
+  printf("  %.2f us per full redraw on this host\n", (double) elapsed / frames);
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
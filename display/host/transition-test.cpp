@@ -0,0 +1,180 @@
+// Runs each transition from one lit frame to another, the way loop()
+// does: a step() and an Update() per frame. The incoming mode starts
+// drawing straight away, under the old frame, and has to be all that's
+// showing at the end. step() itself never shows anything, and the
+// transition never touches the base layer the modes draw in.
+
+#include <Arduino.h>
+#include <stdio.h>
+
+#include "LEDAbstraction.h"
+#include "Transition.h"
+
+static int failures = 0;
+static int thenCalls = 0;
+static LEDAbstraction *thePanel;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static CRGB oldColor(int x, int y)
+{
+  return CRGB(x * 16 + 1, y * 4 + 1, 200);
+}
+
+static CRGB newColor(int x, int y)
+{
+  return CRGB(200, x * 8 + 2, y * 2 + 3);
+}
+
+// The incoming mode
+static void then()
+{
+  thenCalls++;
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
+      thePanel->SetLED(x, y, newColor(x, y));
+    }
+  }
+}
+
+// An incoming mode that draws nothing: it blanks the panel
+static void blank()
+{
+  thenCalls++;
+  thePanel->clear();
+}
+
+static void fillOld(LEDAbstraction *panel)
+{
+  panel->setFadeMode(false);
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
+      panel->SetLED(x, y, oldColor(x, y));
+    }
+  }
+  panel->Update();
+}
+
+// How many pixels of the output show each frame
+static void countShown(uint16_t *oldShown, uint16_t *newShown)
+{
+  *oldShown = *newShown = 0;
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
+      CRGB c = FastLED.leds[panelIndex(x, y)];
+      if (c == newColor(x, y))
+	(*newShown)++;
+      else if (c == oldColor(x, y))
+	(*oldShown)++;
+    }
+  }
+}
+
+static bool baseIsNew(LEDAbstraction *panel)
+{
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
+      if (panel->GetLED(x, y) != newColor(x, y))
+	return false;
+    }
+  }
+  return true;
+}
+
+static void run(LEDAbstraction *panel, Transition *t, uint8_t kind, const char *name, bool fading)
+{
+  fillOld(panel);
+  panel->setFadeMode(fading);
+  thenCalls = 0;
+  t->start(kind, then);
+  check(thenCalls == 1, "then() is called as it starts");
+
+  uint16_t oldShown, newShown;
+  panel->Update();
+  countShown(&oldShown, &newShown);
+  check(oldShown == DISPLAY_PIXELS, "the new mode starts out hidden");
+
+  uint32_t showsBefore = FastLED.shows;
+  uint16_t frames = 0;
+  bool mixed = false, stepShowed = false;
+  while (t->active() && frames < 1000) {
+    uint32_t shows = FastLED.shows;
+    bool finished = t->step();
+    stepShowed = stepShowed || FastLED.shows != shows;
+    frames++;
+    check(finished == !t->active(), "step() reports the finishing frame");
+    panel->Update();
+    countShown(&oldShown, &newShown);
+    mixed = mixed || (newShown && newShown < DISPLAY_PIXELS);
+  }
+  // Give the fader time to land on the new frame
+  for (int i=0; i<10; i++) {
+    panel->Update();
+  }
+  uint32_t shows = FastLED.shows - showsBefore;
+
+  printf("%-9s%s %3u frames, %3u shows\n", name, fading ? " (fading)" : "          ",
+	 frames, shows);
+  check(!t->active() && frames < 1000, "transition finishes");
+  check(!stepShowed, "step() leaves showing to Update()");
+  check(kind == TRANSITION_FADE || mixed, "old and new show together on the way");
+  countShown(&oldShown, &newShown);
+  check(newShown == DISPLAY_PIXELS, "only the new mode shows at the end");
+  check(baseIsNew(panel), "the base layer is left to the new mode");
+  check(thenCalls == 1, "then() called once");
+}
+
+int main(int argc, char *argv[])
+{
+  LEDAbstraction panel;
+  panel.Init();
+  thePanel = &panel;
+  Transition t(&panel);
+
+  for (int fading=0; fading<2; fading++) {
+    run(&panel, &t, TRANSITION_SCROLL, "scroll", fading);
+    run(&panel, &t, TRANSITION_WIPE, "wipe", fading);
+    run(&panel, &t, TRANSITION_DISSOLVE, "dissolve", fading);
+    run(&panel, &t, TRANSITION_FADE, "fade", fading);
+  }
+
+  // Scrolling off to a blanked panel leaves it dark
+  fillOld(&panel);
+  thenCalls = 0;
+  t.start(TRANSITION_SCROLL, blank);
+  while (t.active()) {
+    t.step();
+    panel.Update();
+  }
+  uint16_t lit = 0;
+  for (uint16_t i=0; i<FastLED.numLeds; i++) {
+    if (FastLED.leds[i] != CRGB(0, 0, 0))
+      lit++;
+  }
+  check(thenCalls == 1 && lit == 0, "the panel is black once a blanking transition finishes");
+
+  // A cancelled transition cuts straight to the new mode
+  fillOld(&panel);
+  thenCalls = 0;
+  t.start(TRANSITION_DISSOLVE, then);
+  t.step();
+  t.cancel();
+  panel.Update();
+  uint16_t oldShown, newShown;
+  countShown(&oldShown, &newShown);
+  check(!t.active() && thenCalls == 1, "cancel() drops the transition");
+  check(newShown == DISPLAY_PIXELS, "cancel() shows the new mode");
+
+  if (failures) {
+    printf("%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,235 @@
+#include "snake-autopilot.h"
+
+#include <string.h>
+
+#define CYCLELEN (XSIZE * YSIZE)
+#define UNREACHED 0xFF
+#define SHORTCUT_MAXLEN (CYCLELEN / 4)
+
+static_assert((YSIZE & 1) == 0, "the serpentine cycle needs an even number of rows");
+static_assert(CYCLELEN <= 256, "cycle positions are stored in a uint8_t");
+
+SnakeAutopilot::SnakeAutopilot(Snake *s)
+{
+  engine = s;
+  shortcuts = 0;
+}
+
+SnakeAutopilot::~SnakeAutopilot()
+{
+}
+
+uint32_t SnakeAutopilot::shortcutsTaken()
+{
+  return shortcuts;
+}
+
+// Even rows run left to right, odd rows right to left, and the end of
+// each row drops to the next; the last row drops back to the first.
+uint8_t SnakeAutopilot::cycleOrder(int8_t x, int8_t y)
+{
+  return y * XSIZE + ((y & 1) ? (XSIZE - 1 - x) : x);
+}
+
+void SnakeAutopilot::cycleNext(int8_t x, int8_t y, int8_t *nx, int8_t *ny)
+{
+  *nx = x;
+  *ny = y;
+  if (!(y & 1) && x < XSIZE-1) {
+    (*nx)++;
+  } else if ((y & 1) && x > 0) {
+    (*nx)--;
+  } else {
+    *ny = (y + 1) % YSIZE;
+  }
+}
+
+void SnakeAutopilot::buildBitboards()
+{
+  for (int8_t y=0; y<YSIZE; y++) {
+    uint8_t f = 0;
+    uint8_t food = 0;
+    for (int8_t x=0; x<XSIZE; x++) {
+      uint8_t sq = engine->GetSquareIndex(x, y);
+      if (sq != SQUARE_SNAKE) {
+	f |= (1 << x);
+      }
+      if (sq == SQUARE_FOOD) {
+	food |= (1 << x);
+      }
+    }
+    freeRows[y] = f;
+    foodRows[y] = food;
+  }
+}
+
+// Breadth-first flood outward from the target square through free
+// squares, a whole row at a time. dist[i] ends up as the number of
+// moves from candidate square i to the target (0 if it is the target),
+// or UNREACHED.
+void SnakeAutopilot::distancesTo(int8_t tx, int8_t ty,
+				 const int8_t *cx, const int8_t *cy, uint8_t n,
+				 uint8_t *dist)
+{
+  uint8_t visited[YSIZE];
+  uint8_t frontier[YSIZE];
+  uint8_t next[YSIZE];
+
+  memset(visited, 0, sizeof(visited));
+  visited[ty] = (1 << tx);
+  memcpy(frontier, visited, sizeof(frontier));
+
+  uint8_t remaining = 0;
+  for (uint8_t i=0; i<n; i++) {
+    dist[i] = (visited[cy[i]] & (1 << cx[i])) ? 0 : UNREACHED;
+    if (dist[i] == UNREACHED)
+      remaining++;
+  }
+
+  for (uint8_t d=1; remaining && d<UNREACHED; d++) {
+    bool grew = false;
+    for (int8_t y=0; y<YSIZE; y++) {
+      uint8_t f = frontier[y];
+      // Sideways (wrapping), then from the rows above and below (also
+      // wrapping)
+      uint8_t spread = ((f << 1) | (f >> (XSIZE-1)) |
+			(f >> 1) | (f << (XSIZE-1))) & FULLROW;
+      spread |= frontier[(y + YSIZE - 1) % YSIZE] | frontier[(y + 1) % YSIZE];
+      next[y] = spread & freeRows[y] & ~visited[y];
+      if (next[y])
+	grew = true;
+    }
+    if (!grew)
+      break;
+
+    for (int8_t y=0; y<YSIZE; y++) {
+      visited[y] |= next[y];
+    }
+    memcpy(frontier, next, sizeof(frontier));
+
+    for (uint8_t i=0; i<n; i++) {
+      if (dist[i] == UNREACHED && (visited[cy[i]] & (1 << cx[i]))) {
+	dist[i] = d;
+	remaining--;
+      }
+    }
+  }
+}
+
+char SnakeAutopilot::nextMove()
+{
+  int8_t hx = engine->curX;
+  int8_t hy = engine->curY;
+  int8_t dx = engine->dirX;
+  int8_t dy = engine->dirY;
+
+  buildBitboards();
+
+  // How far along the cycle the head can go before it would land on
+  // the tail, and how much more the snake has yet to grow
+  offset tail = engine->Tail();
+  uint8_t headOrder = cycleOrder(hx, hy);
+  uint16_t gap = (cycleOrder(tail.x, tail.y) + CYCLELEN - headOrder) % CYCLELEN;
+  if (gap == 0) {
+    gap = CYCLELEN; // the tail is the head
+  }
+  uint16_t growth = engine->currentLength - engine->BlockListSize();
+  uint16_t room = 2 + growth + engine->numFoodDisplayed;
+
+  // Each shortcut leaves free squares behind the head that can't be
+  // used until the tail has passed them, and food gets denser as the
+  // snake grows (so the tail moves less). Stop taking shortcuts early
+  // enough that those squares come back before they're needed.
+  bool shortcutsAllowed = (engine->currentLength < SHORTCUT_MAXLEN);
+
+  // Aim for the first food ahead on the cycle. Never passing it means
+  // every move gets closer to it along the cycle, so it's always
+  // reached within a lap.
+  uint16_t toFood = CYCLELEN;
+  int8_t fx = 0, fy = 0;
+  for (int8_t y=0; y<YSIZE; y++) {
+    if (!foodRows[y])
+      continue;
+    for (int8_t x=0; x<XSIZE; x++) {
+      if (foodRows[y] & (1 << x)) {
+	uint16_t d = (cycleOrder(x, y) + CYCLELEN - headOrder) % CYCLELEN;
+	if (d && d < toFood) {
+	  toFood = d;
+	  fx = x;
+	  fy = y;
+	}
+      }
+    }
+  }
+
+  // Straight on, left, right
+  const int8_t turnX[3] = { dx, dy, (int8_t)-dy };
+  const int8_t turnY[3] = { dy, (int8_t)-dx, dx };
+  const char turnInput[3] = { 0, 'a', 'd' };
+
+  int8_t cx[3], cy[3];
+  uint8_t which[3];
+  uint16_t progress[3];
+  uint8_t n = 0;
+  int8_t fallback = -1;
+  for (uint8_t t=0; t<3; t++) {
+    int8_t x = (hx + turnX[t] + XSIZE) % XSIZE;
+    int8_t y = (hy + turnY[t] + YSIZE) % YSIZE;
+    if (!(freeRows[y] & (1 << x)))
+      continue;
+
+    uint16_t d = (cycleOrder(x, y) + CYCLELEN - headOrder) % CYCLELEN;
+    if (d == 1) {
+      // The next square on the cycle, which is always safe
+      fallback = t;
+    } else {
+      // A shortcut: it mustn't pass the food, and must leave the head
+      // far enough behind the tail that the snake could still finish
+      // growing and eat every piece of food on the board (plus one,
+      // because the tail is still there when the head moves)
+      if (!shortcutsAllowed || d > toFood || d >= gap || gap - d < room)
+	continue;
+    }
+    cx[n] = x;
+    cy[n] = y;
+    which[n] = t;
+    progress[n] = d;
+    n++;
+  }
+
+  if (!n) {
+    // Only happens when the board is full
+    return 0;
+  }
+
+  uint8_t dist[3];
+  if (toFood < CYCLELEN) {
+    distancesTo(fx, fy, cx, cy, n, dist);
+  } else {
+    memset(dist, UNREACHED, sizeof(dist));
+  }
+
+  // Nearest to the food wins; among equals, whichever gets further
+  // round the cycle. If the food can't be reached, stick to the cycle.
+  int8_t best = -1;
+  for (uint8_t i=0; i<n; i++) {
+    if (dist[i] == UNREACHED)
+      continue;
+    if (best < 0 || dist[i] < dist[best] ||
+	(dist[i] == dist[best] && progress[i] > progress[best])) {
+      best = i;
+    }
+  }
+
+  uint8_t turn;
+  if (best >= 0) {
+    turn = which[best];
+    if (progress[best] != 1)
+      shortcuts++;
+  } else if (fallback >= 0) {
+    turn = fallback;
+  } else {
+    turn = which[0];
+  }
+  return turnInput[turn];
+}
@@ -0,0 +1,50 @@
+#ifndef __SNAKE_AUTOPILOT_H
+#define __SNAKE_AUTOPILOT_H
+
+#include <stdint.h>
+#include "snake.h"
+
+// Plays Snake for the attract mode without ever running in to itself.
+//
+// The board (a torus, since Step() wraps) is covered by a fixed
+// Hamiltonian cycle, a serpentine through the rows. Following the cycle
+// is always safe. The autopilot cuts across it toward the next food on
+// the cycle whenever the shortcut doesn't pass that food and leaves the
+// head far enough behind the tail for the snake to grow. With that
+// rule, the body always lies in cycle order from tail to head, so the
+// cycle ahead of the head stays clear. Shortcuts stop once the snake
+// covers a quarter of the board, so that it can go on to fill it.
+//
+// Which shortcut to take comes from a breadth-first flood out from the
+// food over a bitboard of the free squares, one row per byte.
+
+class SnakeAutopilot {
+ public:
+  SnakeAutopilot(Snake *s);
+  ~SnakeAutopilot();
+
+  // The input to give the engine before its next Step(): 'a' or 'd' to
+  // turn, or 0 to carry on straight
+  char nextMove();
+
+  // Position of a square along the cycle, and the next square on it
+  static uint8_t cycleOrder(int8_t x, int8_t y);
+  static void cycleNext(int8_t x, int8_t y, int8_t *nx, int8_t *ny);
+
+  uint32_t shortcutsTaken();
+
+ private:
+  void buildBitboards();
+  void distancesTo(int8_t tx, int8_t ty,
+		   const int8_t *cx, const int8_t *cy, uint8_t n,
+		   uint8_t *dist);
+
+  Snake *engine;
+
+  uint8_t freeRows[YSIZE]; // bit x set if (x,y) can be moved on to
+  uint8_t foodRows[YSIZE];
+
+  uint32_t shortcuts;
+};
+
+#endif
@@ -11,46 +11,37 @@
 #define SNAKE 'S'
 #define FOOD '.'
 
+static_assert(XSIZE <= 8, "dirty cells are tracked in a uint8_t per row");
+static_assert(YSIZE <= 32, "dirty rows are tracked in a uint32_t");
+static_assert(SNAKE_MAXLEN <= 256, "free cells are numbered with a uint8_t");
 
-static int RandomLessThan(int limit)
-{
-#ifdef UNIX
-  int r, d = RAND_MAX / limit;
-  limit *= d;
-  do { r = rand(); } while (r >= limit);
-  return r / d;
-#else
-  return random(limit-1);
-#endif
-}
 
 Snake::Snake()
 {
-  snakeBlockList = NULL;
+  bodyHead = 0;
+  bodyLength = 0;
 }
 
 Snake::~Snake()
 {
-  while (snakeBlockList) {
-    offsetList *o = snakeBlockList;
-    snakeBlockList = snakeBlockList->next;
-    delete o;
-  }
 }
 
 void Snake::Init()
 {
-  while (snakeBlockList) {
-    offsetList *o = snakeBlockList;
-    snakeBlockList = snakeBlockList->next;
-    delete o;
-  }
+  bodyHead = 0;
+  bodyLength = 0;
 
   for (int x=0; x<XSIZE; x++) {
     for (int y=0; y<YSIZE; y++) {
       board[y][x] = 0;
     }
   }
+  for (uint16_t i=0; i<SNAKE_MAXLEN; i++) {
+    freeCells[i] = i;
+    freePos[i] = i;
+  }
+  numFreeCells = SNAKE_MAXLEN;
+  MarkAllDirty();
 
   currentScore = 0;
   numFoodDisplayed = 0;
@@ -65,43 +56,91 @@ void Snake::Init()
 
 void Snake::AddSnakeBlock(int x, int y)
 {
-  offsetList *o = new offsetList;
-  o->next = snakeBlockList;
-  o->pos.x = x;
-  o->pos.y = y;
-  snakeBlockList = o;
+  // Step() won't move the head on to the body, so this can't overflow
+  bodyHead = (bodyHead + 1) % SNAKE_MAXLEN;
+  body[bodyHead].x = x;
+  body[bodyHead].y = y;
+  bodyLength++;
 
-  board[y][x] = SNAKE;
+  SetSquare(x, y, SNAKE);
 }
 
-int Snake::BlockListSize()
+uint16_t Snake::BlockListSize()
 {
-  int i=0;
-
-  offsetList *o = snakeBlockList;
-  while (o) {
-    i++;
-    o = o->next;
-  }
-  return i;
+  return bodyLength;
 }
 
 void Snake::DeleteOldestSnakeBlock()
 {
-  offsetList *o = snakeBlockList;
-  offsetList *p = NULL;
-  while (o) {
-    if (!o->next) {
-      if (p) {
-	p->next = NULL;
-	board[o->pos.y][o->pos.x] = 0;
-	delete o;
-      }
-      break;
+  // Never remove the head
+  if (bodyLength <= 1)
+    return;
+
+  offset tail = Tail();
+  SetSquare(tail.x, tail.y, 0);
+  bodyLength--;
+}
+
+offset Snake::Tail()
+{
+  return body[(bodyHead + SNAKE_MAXLEN - (bodyLength - 1)) % SNAKE_MAXLEN];
+}
+
+void Snake::Seed(uint32_t s)
+{
+  rng.seed(s);
+}
+
+// FNV-1a over what's visible on the board, for checking replays
+uint32_t Snake::BoardHash()
+{
+  uint32_t h = 2166136261UL;
+  for (int y=0; y<YSIZE; y++) {
+    for (int x=0; x<XSIZE; x++) {
+      h = (h ^ GetSquare(x, y)) * 16777619UL;
     }
-    p = o;
-    o = o->next;
   }
+  return h;
+}
+
+void Snake::SetSquare(int8_t x, int8_t y, uint8_t v)
+{
+  uint8_t cell = y * XSIZE + x;
+  if (v && !board[y][x]) {
+    // No longer free: move the last free cell in to its slot
+    uint8_t last = freeCells[--numFreeCells];
+    freeCells[freePos[cell]] = last;
+    freePos[last] = freePos[cell];
+  } else if (!v && board[y][x]) {
+    freePos[cell] = numFreeCells;
+    freeCells[numFreeCells++] = cell;
+  }
+
+  board[y][x] = v;
+  dirtyRows |= (1UL << y);
+  dirtyCells[y] |= (1 << x);
+}
+
+uint32_t Snake::DirtyRows()
+{
+  return dirtyRows;
+}
+
+uint8_t Snake::DirtyCells(int8_t y)
+{
+  return dirtyCells[y];
+}
+
+void Snake::ClearDirty()
+{
+  dirtyRows = 0;
+  memset(dirtyCells, 0, sizeof(dirtyCells));
+}
+
+void Snake::MarkAllDirty()
+{
+  dirtyRows = (YSIZE == 32) ? 0xFFFFFFFFUL : ((1UL << YSIZE) - 1);
+  memset(dirtyCells, (1 << XSIZE) - 1, sizeof(dirtyCells));
 }
 
 int Snake::GetSquare(int x, int y)
@@ -113,6 +152,18 @@ int Snake::GetSquare(int x, int y)
   return ' ';
 }
 
+uint8_t Snake::GetSquareIndex(int8_t x, int8_t y)
+{
+  switch (board[y][x]) {
+  case SNAKE:
+    return SQUARE_SNAKE;
+  case FOOD:
+    return SQUARE_FOOD;
+  }
+
+  return SQUARE_EMPTY;
+}
+
 bool Snake::Step()
 {
   curX = (curX + dirX) % (XSIZE);
@@ -191,14 +242,18 @@ void Snake::SetupTest()
 {
 }
 
-void Snake::AddRandomFood()
+// Picks uniformly from the empty squares, so this always succeeds
+// (unless the board is full) in constant time
+bool Snake::AddRandomFood()
 {
-  int8_t newX, newY;
-  newX = RandomLessThan(XSIZE);
-  newY = RandomLessThan(YSIZE);
-  if (!board[newY][newX]) {
-    // If we pick a space that's already filled, then just defer.
-    board[newY][newX] = FOOD;
-    numFoodDisplayed++;
+  if (!numFreeCells) {
+    return false;
   }
+
+  uint8_t cell = freeCells[rng.lessThan(numFreeCells)];
+  lastFood.x = cell % XSIZE;
+  lastFood.y = cell / XSIZE;
+  SetSquare(lastFood.x, lastFood.y, FOOD);
+  numFoodDisplayed++;
+  return true;
 }
@@ -3,6 +3,7 @@
 
 #include <stdint.h> // for uint8_t
 #include "tetris.h"
+#include "GameRandom.h"
 
 #ifndef YSIZE
 #define YSIZE 32
@@ -19,10 +20,8 @@
   int8_t y;
   } offset;*/
 
-typedef struct _offsetList {
-  offset pos;
-  struct _offsetList *next;
-} offsetList;
+// The snake can't be any longer than the board is big
+#define SNAKE_MAXLEN (XSIZE * YSIZE)
 
 class Snake {
  public:
@@ -30,38 +29,71 @@ class Snake {
   ~Snake();
 
   void Init();
+  void Seed(uint32_t s); // call before Init() to replay a game
+  uint32_t BoardHash();
 
   void SetupTest();
 
   int GetSquare(int x, int y);
+  uint8_t GetSquareIndex(int8_t x, int8_t y);
   bool Step(); // return true while game still going
 
+  // Which cells have changed since the last ClearDirty(), so the
+  // renderer only has to redraw those
+  uint32_t DirtyRows(); // bit y set if anything in row y changed
+  uint8_t DirtyCells(int8_t y); // bit x set if (x,y) changed
+  void ClearDirty();
+  void MarkAllDirty();
+
   void TurnLeft();
   void TurnRight();
 
   uint32_t score();
+  offset Tail();
 
   // private:
  public:
   bool IsPieceBlocked();
   
   void AddSnakeBlock(int x, int y);
-  int BlockListSize();
+  uint16_t BlockListSize();
   void DeleteOldestSnakeBlock();
 
-  void AddRandomFood();
+  bool AddRandomFood();
+
+  void SetSquare(int8_t x, int8_t y, uint8_t v);
 
   // private:
  public:
   uint8_t board[YSIZE][XSIZE];
-  offsetList *snakeBlockList;
-  uint8_t currentLength;
+
+  // The body, as a ring: body[bodyHead] is the head, and the
+  // bodyLength-1 entries before it (wrapping around) are the rest
+  offset body[SNAKE_MAXLEN];
+  uint16_t bodyHead;
+  uint16_t bodyLength;
+
+  // Every empty square, as a dense set: freeCells[0..numFreeCells) are
+  // cell numbers (y*XSIZE+x), and freePos[cell] is where that cell is
+  // in freeCells (when it's free)
+  uint8_t freeCells[SNAKE_MAXLEN];
+  uint8_t freePos[SNAKE_MAXLEN];
+  uint16_t numFreeCells;
+
+  offset lastFood;
+
+  uint16_t currentLength;
   int8_t curX, curY;
   int8_t dirX, dirY;
 
   uint8_t numFoodDisplayed;
 
+  uint32_t dirtyRows;
+  uint8_t dirtyCells[YSIZE];
+
   uint32_t currentScore;
+
+  GameRandom rng;
 };
 
 #endif
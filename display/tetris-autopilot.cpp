@@ -0,0 +1,268 @@
+#include "tetris-autopilot.h"
+
+#include <Arduino.h>
+
+// Board evaluation weights (x100), after Yiyuan Lee's tuned
+// four-feature player
+#define WEIGHT_HEIGHT -51
+#define WEIGHT_LINES   76
+#define WEIGHT_HOLES  -36
+#define WEIGHT_BUMPS  -18
+
+#define NOSCORE ((int32_t)0x80000000)
+
+// Give up steering and just drop if the engine refuses a move this
+// many times in a row (i.e. the path is blocked)
+#define MAXSTUCK 3
+
+static uint8_t popcount8(uint8_t v)
+{
+  uint8_t c = 0;
+  while (v) {
+    v &= v - 1;
+    c++;
+  }
+  return c;
+}
+
+TetrisAutopilot::TetrisAutopilot(Tetris *t)
+{
+  engine = t;
+  evaluated = 0;
+  reset();
+}
+
+TetrisAutopilot::~TetrisAutopilot()
+{
+}
+
+void TetrisAutopilot::reset()
+{
+  searching = false;
+  planReady = false;
+  haveFirst = false;
+  stuckCount = 0;
+  lastX = -1;
+  lastRotation = -1;
+}
+
+uint32_t TetrisAutopilot::placementsEvaluated()
+{
+  return evaluated;
+}
+
+// Score a board: fewer holes, a flatter and lower stack, and more
+// cleared lines are all better.
+int32_t TetrisAutopilot::evaluate(const uint8_t *rows, uint8_t lines)
+{
+  uint8_t heights[XSIZE] = { 0 };
+  uint8_t covered = 0;
+  int32_t holes = 0;
+
+  for (int8_t y=0; y<YSIZE; y++) {
+    uint8_t newTops = rows[y] & ~covered;
+    for (int8_t x=0; newTops; x++, newTops >>= 1) {
+      if (newTops & 1)
+	heights[x] = YSIZE - y;
+    }
+    covered |= rows[y];
+    holes += popcount8(covered & ~rows[y]);
+  }
+
+  int32_t aggregate = 0;
+  int32_t bumps = 0;
+  for (int8_t x=0; x<XSIZE; x++) {
+    aggregate += heights[x];
+    if (x) {
+      bumps += (heights[x] > heights[x-1]) ? heights[x] - heights[x-1] : heights[x-1] - heights[x];
+    }
+  }
+
+  return WEIGHT_HEIGHT * aggregate + WEIGHT_LINES * lines +
+    WEIGHT_HOLES * holes + WEIGHT_BUMPS * bumps;
+}
+
+// Drop a piece straight down from (x, y) on to rows, writing the
+// resulting board (with full lines removed) to out. Returns the number
+// of lines cleared, or -1 if the piece doesn't fit at its start.
+int8_t TetrisAutopilot::dropPiece(const uint8_t *rows, const pieceMask *m,
+				  int8_t x, int8_t y, uint8_t *out)
+{
+  uint8_t placed[PIECE_BOXSIZE];
+  for (int8_t r=0; r<PIECE_BOXSIZE; r++) {
+    placed[r] = Tetris::PlaceRowMask(m->rows[r], x);
+  }
+
+  // Walk down until the next row would collide or hit the floor
+  bool blocked = false;
+  int8_t testY = y;
+  while (!blocked) {
+    if (testY + m->maxY >= YSIZE) {
+      blocked = true;
+      break;
+    }
+    for (int8_t r=0; r<PIECE_BOXSIZE; r++) {
+      int8_t by = testY + r - PIECE_YBIAS;
+      if (placed[r] && by >= 0 && (rows[by] & placed[r])) {
+	blocked = true;
+	break;
+      }
+    }
+    if (!blocked)
+      testY++;
+  }
+  if (testY == y) {
+    return -1;
+  }
+  testY--;
+
+  memcpy(out, rows, YSIZE);
+  for (int8_t r=0; r<PIECE_BOXSIZE; r++) {
+    int8_t by = testY + r - PIECE_YBIAS;
+    if (by >= 0)
+      out[by] |= placed[r];
+  }
+
+  // Compact the board, dropping full rows
+  int8_t lines = 0;
+  int8_t dst = YSIZE - 1;
+  for (int8_t src=YSIZE-1; src>=0; src--) {
+    if (out[src] == FULLROW) {
+      lines++;
+    } else {
+      out[dst--] = out[src];
+    }
+  }
+  while (dst >= 0) {
+    out[dst--] = 0;
+  }
+
+  return lines;
+}
+
+// Step a cursor to the next legal rotation x column for a piece,
+// skipping rotations that look the same as an earlier one. Returns
+// false when they've all been visited.
+bool TetrisAutopilot::advanceCursor(placementCursor *c, uint8_t piece)
+{
+  if (c->started) {
+    c->x++;
+    if (c->x + c->mask.maxX < XSIZE)
+      return true;
+  } else {
+    c->started = true;
+    c->rotation = 0;
+    Tetris::GetPieceMask(piece, 0, &c->mask);
+    c->x = -c->mask.minX;
+    return true;
+  }
+
+  while (++c->rotation < 4) {
+    Tetris::GetPieceMask(piece, c->rotation, &c->mask);
+    bool duplicate = false;
+    for (uint8_t r=0; r<c->rotation && !duplicate; r++) {
+      pieceMask earlier;
+      Tetris::GetPieceMask(piece, r, &earlier);
+      duplicate = !memcmp(&earlier.rows, &c->mask.rows, sizeof(earlier.rows));
+    }
+    if (!duplicate) {
+      c->x = -c->mask.minX;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TetrisAutopilot::nextFirstPlacement()
+{
+  while (advanceCursor(&first, engine->currentPiece())) {
+    firstLines = dropPiece(board, &first.mask, first.x, spawnY, afterFirst);
+    if (firstLines >= 0) {
+      second.started = false;
+      haveFirst = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TetrisAutopilot::evaluateNextSecondPlacement()
+{
+  if (!advanceCursor(&second, engine->nextPiece())) {
+    haveFirst = false;
+    return;
+  }
+
+  uint8_t afterSecond[YSIZE];
+  int8_t lines = dropPiece(afterFirst, &second.mask, second.x, 0, afterSecond);
+  evaluated++;
+
+  int32_t score = (lines < 0) ?
+    evaluate(afterFirst, firstLines) + WEIGHT_HEIGHT * YSIZE :
+    evaluate(afterSecond, firstLines + lines);
+  if (score > bestScore) {
+    bestScore = score;
+    bestRotation = first.rotation;
+    bestX = first.x;
+  }
+}
+
+bool TetrisAutopilot::think(uint32_t budgetMicros)
+{
+  if (planReady)
+    return true;
+
+  if (!searching) {
+    engine->GetSettledRows(board);
+    spawnY = engine->currentY();
+    first.started = false;
+    haveFirst = false;
+    bestScore = NOSCORE;
+    bestRotation = engine->currentRotation();
+    bestX = engine->currentX();
+    searching = true;
+  }
+
+  uint32_t startedAt = micros();
+  do {
+    if (!haveFirst && !nextFirstPlacement()) {
+      searching = false;
+      planReady = true;
+      return true;
+    }
+    evaluateNextSecondPlacement();
+  } while (micros() - startedAt < budgetMicros);
+
+  return false;
+}
+
+char TetrisAutopilot::nextMove()
+{
+  if (!planReady)
+    return 0;
+
+  int8_t rot = engine->currentRotation();
+  int8_t x = engine->currentX();
+
+  if (rot == lastRotation && x == lastX) {
+    stuckCount++;
+  } else {
+    stuckCount = 0;
+  }
+  lastRotation = rot;
+  lastX = x;
+
+  if (stuckCount < MAXSTUCK) {
+    if (rot != bestRotation) {
+      // Rotate whichever way is shorter
+      return (((bestRotation - rot) & 3) == 3) ? 'q' : 'e';
+    }
+    if (x > bestX)
+      return 'a';
+    if (x < bestX)
+      return 'd';
+  }
+
+  planReady = false;
+  return ' ';
+}
@@ -0,0 +1,73 @@
+#ifndef __TETRIS_AUTOPILOT_H
+#define __TETRIS_AUTOPILOT_H
+
+#include <stdint.h>
+#include "tetris.h"
+
+// Plays the real Tetris engine for the attract mode. For the falling
+// piece and the preview piece, every rotation x column placement is
+// dropped on a copy of the board and scored; the best first placement
+// is then fed to the engine one move at a time.
+//
+// The search is resumable: think() only runs for as long as it's
+// allowed, so it can be spread across several passes of loop().
+
+typedef struct _placementCursor {
+  uint8_t rotation;
+  int8_t x;
+  bool started;
+  pieceMask mask;
+} placementCursor;
+
+class TetrisAutopilot {
+ public:
+  TetrisAutopilot(Tetris *t);
+  ~TetrisAutopilot();
+
+  // Forget the current plan; call whenever a new piece starts falling
+  void reset();
+
+  // Search for up to budgetMicros. Returns true once a plan is ready.
+  bool think(uint32_t budgetMicros);
+
+  // The next input for the engine ('q', 'e', 'a', 'd' or ' ' to drop),
+  // or 0 if the search hasn't finished yet
+  char nextMove();
+
+  uint32_t placementsEvaluated();
+
+  static int32_t evaluate(const uint8_t *rows, uint8_t lines);
+  static int8_t dropPiece(const uint8_t *rows, const pieceMask *m,
+			  int8_t x, int8_t y, uint8_t *out);
+
+ private:
+  bool nextFirstPlacement();
+  void evaluateNextSecondPlacement();
+
+  static bool advanceCursor(placementCursor *c, uint8_t piece);
+
+  Tetris *engine;
+
+  uint8_t board[YSIZE];      // settled rows when the search started
+  uint8_t afterFirst[YSIZE]; // ... and after the first placement
+  int8_t firstLines;
+  int8_t spawnY;
+
+  placementCursor first;
+  placementCursor second;
+  bool haveFirst;
+  bool searching;
+  bool planReady;
+
+  int32_t bestScore;
+  uint8_t bestRotation;
+  int8_t bestX;
+
+  int8_t lastX;
+  int8_t lastRotation;
+  uint8_t stuckCount;
+
+  uint32_t evaluated;
+};
+
+#endif
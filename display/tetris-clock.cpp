@@ -3,8 +3,6 @@
 
 #define MAX(x,y) ((x) > (y) ? (x) : (y))
 
-extern tetTemplate tetromino[NUMPIECES];
-
 enum {
   P_I = 0,
   P_O = 1,
@@ -90,15 +88,14 @@ const uint8_t colonGap = 3;
 const uint8_t colonHeight = 2;
 const uint8_t colonXpos[2] = {2,5};
 
-TetrisClock::TetrisClock(LEDAbstraction *p)
+TetrisClock::TetrisClock(LEDAbstraction *p) :
+  timeline(p)
 {
   ledPanel = p;
 
   queueTailPos = queueHeadPos = 0;
   queueSize = 0;
 
-  currentPieceDropping.id = P_NONE;
-
   hourCounter = 0;
   minuteCounter = 0;
   secondCounter = 0;
@@ -110,36 +107,11 @@ TetrisClock::~TetrisClock()
 {
 }
 
-static CRGB colorOfPiece(uint8_t idx)
+// The clock face is drawn in a single color; SQUARE_PIECE(idx) would
+// give each piece its own palette color instead
+static uint8_t colorOfPiece(uint8_t idx)
 {
-  CRGB outColor;
-  outColor = CHSV(HUE_GREEN,255,255);
-  return outColor; // testing single-color
-
-  switch (idx) {
-  case P_I:
-    outColor = CRGB::White;
-    break;
-  case P_O:
-    outColor = CHSV(HUE_ORANGE,255,255);
-    break;
-  case P_S:
-    outColor = CHSV(HUE_YELLOW,255,255);
-    break;
-  case P_Z:
-    outColor = CHSV(HUE_AQUA,255,255);
-    break;
-  case P_L:
-    outColor = CHSV(HUE_BLUE,255,255);
-    break;
-  case P_J:
-    outColor = CHSV(HUE_PURPLE,255,255);
-    break;
-  case P_T:
-    outColor = CHSV(HUE_PINK,255,255);
-    break;
-  }
-  return outColor;
+  return PAL_CLOCK;
 }
 
 // Drop the pieces for a digit in to place, Tetris-style.
@@ -209,13 +181,13 @@ pieceElement TetrisClock::pop()
 }
 
 void TetrisClock::queuePieceToDrop(uint8_t idx,
-				   CRGB color,
+				   uint8_t colorIndex,
 				   uint8_t xctr,
 				   uint8_t yctr,
 				   uint8_t rot)
 {
   dropQueue[queueTailPos].id = idx;
-  dropQueue[queueTailPos].color = color;
+  dropQueue[queueTailPos].colorIndex = colorIndex;
   dropQueue[queueTailPos].position.x = xctr;
   dropQueue[queueTailPos].position.y = yctr;
   dropQueue[queueTailPos].rotation = rot;
@@ -224,77 +196,105 @@ void TetrisClock::queuePieceToDrop(uint8_t idx,
   queueSize++;
 }
 
-// Return how many millis until we should call step() again, or 0 when
-// we're completely done
-unsigned long TetrisClock::step()
+// The cells of a piece that are on the panel
+static uint8_t pieceCells(uint8_t id, uint8_t rot, offset pos, timelineCell *cells)
 {
-  unsigned long retDelay = 150; // assume 150ms delay
-
-  // Is there a piece dropping right now? If not, then we need to get one
-  if (currentPieceDropping.id == P_NONE) {
-    if (queueSize) {
-      currentPieceDropping = pop();
-      
-      currentPosition = { 4, -1 };
-      currentRotation = 0;
-    } else {
-      // Ain't no more pieces; all done!
-      if (isInTreeMode) {
-	return 99999; // FIXME: terrible handling of magic constant
-      } else {
-	return 0;
-      }
+  uint8_t n = 0;
+  for (int j=0; j<4; j++) {
+    const offset *o = &tetromino[id].pixelsInRotation[rot][j];
+    int8_t x = pos.x + (int8_t) pgm_read_byte(&o->x);
+    int8_t y = pos.y + (int8_t) pgm_read_byte(&o->y);
+    if (y >= 0 && y < DISPLAY_HEIGHT && x >= 0 && x < DISPLAY_WIDTH) {
+      cells[n++] = y * DISPLAY_WIDTH + x;
     }
   }
+  return n;
+}
 
-  // If we reach here, then something is dropping! If it isn't at the very top,
-  // then we need to erase whatever we drew last step...
-  if (currentPosition.y != -1) {
-    for (int j=0; j<4; j++) {
-      int8_t x = currentPosition.x + tetromino[currentPieceDropping.id].pixelsInRotation[currentRotation][j].x;
-      int8_t y = currentPosition.y + tetromino[currentPieceDropping.id].pixelsInRotation[currentRotation][j].y;
-      if (y >= 0 && y < 32 && x >= 0 && x < 8) {
-	ledPanel->SetLED(x, y, CRGB::Black);
+// Drops everything in the queue, frame by frame, in to the timeline.
+// Each piece comes on at the top, then walks sideways and rotates in to
+// place as it falls, a row per frame.
+void TetrisClock::compileTimeline()
+{
+  timeline.clear();
+  uint8_t firstPiece = queueHeadPos;
+  uint8_t pieces = queueSize;
+
+  while (queueSize) {
+    pieceElement piece = pop();
+    offset pos = { 4, -1 };
+    uint8_t rot = 0;
+
+    bool landed = false;
+    while (!landed) {
+      timelineCell cleared[TIMELINE_FRAME_CELLS], set[TIMELINE_FRAME_CELLS];
+      uint8_t clearedCount = 0;
+      uint16_t delay = 150;
+
+      if (pos.y != -1) {
+	clearedCount = pieceCells(piece.id, rot, pos, cleared);
+
+	if (pos.x > piece.position.x) pos.x--;
+	else if (pos.x < piece.position.x) pos.x++;
+	else if (rot != piece.rotation) rot++;
+	else delay = 50;
       }
-    }
-  }
 
-  // shift its position/rotation (if we've started dropping)
-  if (currentPosition.y != -1) {
-    if (currentPosition.x > currentPieceDropping.position.x) currentPosition.x--;
-    else if (currentPosition.x < currentPieceDropping.position.x) currentPosition.x++;
-    else if (currentRotation != currentPieceDropping.rotation) currentRotation++;
-    else retDelay = 50;
-  }
-  
-  // Move down one row
-  currentPosition.y++;
+      pos.y++;
+      uint8_t setCount = pieceCells(piece.id, rot, pos, set);
 
-  // draw the piece
-  for (int j=0; j<4; j++) {
-    int8_t x = currentPosition.x + tetromino[currentPieceDropping.id].pixelsInRotation[currentRotation][j].x;
-    int8_t y = currentPosition.y + tetromino[currentPieceDropping.id].pixelsInRotation[currentRotation][j].y;
-    if (y >= 0 && y < 32 && x >= 0 && x < 8) {
-      ledPanel->SetLED(x, y, currentPieceDropping.color);
+      if (pos.y == 0) {
+	// Its first position on the screen gets an extra delay, like a
+	// new game piece while playing actual Tetris
+	delay = 750;
+      } else if (pos.x == piece.position.x && rot == piece.rotation &&
+		 pos.y == piece.position.y) {
+	landed = true;
+      }
+      // A piece that isn't in place by the time it passes its row
+      // would fall forever; stop it once it's off the bottom
+      if (pos.y > TIMELINE_FACE_ROWS + 2)
+	landed = true;
+
+      timeline.addFrame(cleared, clearedCount, set, setCount, piece.colorIndex, delay);
     }
   }
 
-  // Draw the changes
-  ledPanel->Update();
-  
-  if (currentPosition.y == 0) {
-    // If it's the first position on the screen, then delay extra,
-    // like it's a new game piece while playing actual Tetris
-    return 750;
-  }
-  else if (currentPosition.x == currentPieceDropping.position.x && currentRotation == currentPieceDropping.rotation) {
-    // If it's in its final place, we're done with this piece.
-    if (currentPosition.y == currentPieceDropping.position.y) {
-      currentPieceDropping.id = P_NONE;
+  if (timeline.overflowed()) {
+    // Too long to animate; put each piece straight in to place instead,
+    // so the face is at least whole
+    timeline.clear();
+    queueHeadPos = firstPiece;
+    queueSize = pieces;
+    while (queueSize) {
+      pieceElement piece = pop();
+      timelineCell cleared[TIMELINE_FRAME_CELLS], set[TIMELINE_FRAME_CELLS];
+      uint8_t setCount = pieceCells(piece.id, piece.rotation, piece.position, set);
+      timeline.addFrame(cleared, 0, set, setCount, piece.colorIndex, 750);
     }
   }
+}
+
+// Draws the next frame and returns true, or returns false once the face
+// is finished; frameDelay() says when to call again
+bool TetrisClock::step()
+{
+  return timeline.step();
+}
+
+unsigned long TetrisClock::frameDelay()
+{
+  return timeline.frameDelay();
+}
 
-  return retDelay;
+bool TetrisClock::showingTree()
+{
+  return isInTreeMode;
+}
+
+ClockTimeline *TetrisClock::playback()
+{
+  return &timeline;
 }
 
 uint32_t TetrisClock::setTime(uint8_t h, uint8_t m, uint8_t s=0, uint8_t curMon=0, uint8_t curDay=0)
@@ -338,21 +338,20 @@ void TetrisClock::startDisplay()
   // Reset the piece queue
   queueTailPos = queueHeadPos = 0;
   queueSize = 0;
-  currentPieceDropping.id = P_NONE;
 
   // Queue up all of the pieces that need to be drawn. Do it from the
   // bottom to the top. Stick a colon in the middle.
-  uint8_t ypos = 31; // count upward to find the upper-left corner of each piece
+  uint8_t ypos = TIMELINE_FACE_ROWS-1; // count upward to find the upper-left corner of each piece
 
   uint8_t curH = hourCounter;
   uint8_t curM = minuteCounter;
-  uint8_t curS = secondCounter;
 
   if ( ((currentMonth == 12 && currentDay >= 16) ||
 	(currentMonth == 1 && currentDay <= 6)) &&
        (minuteCounter == 15 || minuteCounter == 30 || minuteCounter == 45) ) {
     // draw a tree instead of the clock
     queueTreePieces();
+    compileTimeline();
     return;
   }
 
@@ -387,6 +386,8 @@ void TetrisClock::startDisplay()
 
   ypos -= (colonGap + hrsHeight + 1);
   drawTwoDigitsAt(curH/10, curH%10, 0, ypos+leftoffset, 4, ypos+rightoffset+1);
+
+  compileTimeline();
 }
 
 uint32_t TetrisClock::curTime()
@@ -4,13 +4,15 @@
 #include <stdint.h>
 #include "LEDAbstraction.h"
 #include "tetris.h"
+#include "Palette.h"
+#include "ClockTimeline.h"
 
 // Size of the backing piece queue: max of 4 pieces per number, plus 2 for the colon
 #define QUEUESIZE 18
 
 typedef struct _pieceElement {
   uint8_t id;
-  CRGB color;
+  uint8_t colorIndex; // in to the palette
   offset position;
   uint8_t rotation;
 } pieceElement;
@@ -27,10 +29,13 @@ class TetrisClock {
 		       uint8_t hpos1, uint8_t vpos1, 
 		       uint8_t hpos2, uint8_t vpos2);
 
-  unsigned long step();
+  bool step(); // false once the face is finished
+  unsigned long frameDelay(); // until the next step()
+  bool showingTree(); // the face is a tree, not the time
+  ClockTimeline *playback(); // to pause, speed up or scrub the face
 
   void queuePieceToDrop(uint8_t idx,
-			CRGB color,
+			uint8_t colorIndex,
 			uint8_t xctr,
 			uint8_t yctr,
 			uint8_t rot);
@@ -44,14 +49,11 @@ class TetrisClock {
 
  private:
   void queueTreePieces();
-
+  void compileTimeline();
 
   LEDAbstraction *ledPanel;
 
-  // While dropping a piece, here's the state:
-  offset currentPosition;
-  uint8_t currentRotation;
-  pieceElement currentPieceDropping;
+  ClockTimeline timeline;
 
   pieceElement dropQueue[QUEUESIZE];
   uint8_t queueTailPos;
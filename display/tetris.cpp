@@ -3,19 +3,26 @@
 #ifdef UNIX
 #include <stdlib.h>
 #include <ncurses.h>
-#include <string.h> // for memcpy
+#include <string.h> // for memmove
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define memcpy_P memcpy
 #else
 #include <Arduino.h>
 #endif
 
 // The display's upper-left is 0,0 and increases down and to the right.
 
+static_assert(XSIZE <= 8, "board rows must fit in a uint8_t occupancy mask");
+static_assert((XSIZE & 1) == 0, "piece index plane packs two cells per byte");
+static_assert(YSIZE <= 32, "dirty rows are tracked in a uint32_t");
+
 // It's important that the I piece is first; we need that to determine which 
 // superrotation template to use when rotating I-pieces
 static uint8_t pieceSymbols[] = { '|', '*', 'z', 'Z', 'L', 'J', 'T' };
 
 //The wall kick data is keyed off of the *new* rotation, not the old
-static superRotationTemplate wallKickNotI = { 
+static constexpr superRotationTemplate wallKickNotI PROGMEM = { 
   { 
   { {-1, 0}, {-1,1}, {0, -2}, {-1, -2} }, // rotation (CW) 3 >> 0
   { {-1, 0}, {-1, -1}, {0, 2}, {-1, 2} }, // rotation (CW) 0 >> 1
@@ -29,7 +36,7 @@ static superRotationTemplate wallKickNotI = {
   }
 };
 
-static superRotationTemplate wallKickI = { 
+static constexpr superRotationTemplate wallKickI PROGMEM = { 
   {
   { { 1, 0}, {-2, 0}, { 1,2}, {-2, -1} }, // rotation (CW) 3 >> 0
   { {-2, 0}, {1, 0}, {-2, 1}, {1, -2} }, // rotation (CW) 0 >> 1
@@ -44,7 +51,7 @@ static superRotationTemplate wallKickI = {
 };
 
 
-tetTemplate tetromino[NUMPIECES] = {
+constexpr tetTemplate tetromino[NUMPIECES] PROGMEM = {
   { { { {-1, 0}, { 1, 0}, { 2, 0}, { 0, 0} }, // I XOXX X XOXX X
       { { 0, 1}, { 0, 2}, { 0,-1}, { 0, 0} }, //        O      O
       { {-1, 0}, { 1, 0}, { 2, 0}, { 0, 0} }, //        X      X
@@ -87,29 +94,105 @@ tetTemplate tetromino[NUMPIECES] = {
     },
   },
 
-  { { { {-1, 0}, { 1, 0}, { 0,-1}, }, // T  X  X       X
-      { { 1, 0}, { 0, 1}, { 0,-1}, }, //   XOX OX XOX XO
-      { {-1, 0}, { 1, 0}, { 0, 1}, }, //       X   X   X
-      { {-1, 0}, { 0, 1}, { 0,-1}, }  //
+  { { { {-1, 0}, { 1, 0}, { 0,-1}, { 0, 0} }, // T  X  X       X
+      { { 1, 0}, { 0, 1}, { 0,-1}, { 0, 0} }, //   XOX OX XOX XO
+      { {-1, 0}, { 1, 0}, { 0, 1}, { 0, 0} }, //       X   X   X
+      { {-1, 0}, { 0, 1}, { 0,-1}, { 0, 0} }  //
     },
   },
 
 };
 
+// Compile-time generation of the row masks and bounding boxes from the
+// offset tables above. (C++11 constexpr, so it's all single-expression
+// helpers.)
 
+static constexpr int8_t min2(int8_t a, int8_t b) { return a < b ? a : b; }
+static constexpr int8_t max2(int8_t a, int8_t b) { return a > b ? a : b; }
 
-static int RandomLessThan(int limit)
+static constexpr uint8_t offsetRowBit(const offset &o, int8_t dy)
 {
-#ifdef UNIX
-  int r, d = RAND_MAX / limit;
-  limit *= d;
-  do { r = rand(); } while (r >= limit);
-  return r / d;
-#else
-  return random(limit-1);
-#endif
+  return (o.y == dy && o.x >= -PIECE_XBIAS && o.x < PIECE_BOXSIZE - PIECE_XBIAS) ?
+    (1 << (o.x + PIECE_XBIAS)) : 0;
 }
 
+static constexpr uint8_t rowMaskOf(const offset *o, int8_t dy)
+{
+  return offsetRowBit(o[0], dy) | offsetRowBit(o[1], dy) |
+    offsetRowBit(o[2], dy) | offsetRowBit(o[3], dy);
+}
+
+#define PIECEMASK(p, r) {						\
+    { rowMaskOf(tetromino[p].pixelsInRotation[r], -1),			\
+      rowMaskOf(tetromino[p].pixelsInRotation[r], 0),			\
+      rowMaskOf(tetromino[p].pixelsInRotation[r], 1),			\
+      rowMaskOf(tetromino[p].pixelsInRotation[r], 2) },			\
+    min2(min2(tetromino[p].pixelsInRotation[r][0].x, tetromino[p].pixelsInRotation[r][1].x), \
+	 min2(tetromino[p].pixelsInRotation[r][2].x, tetromino[p].pixelsInRotation[r][3].x)), \
+    max2(max2(tetromino[p].pixelsInRotation[r][0].x, tetromino[p].pixelsInRotation[r][1].x), \
+	 max2(tetromino[p].pixelsInRotation[r][2].x, tetromino[p].pixelsInRotation[r][3].x)), \
+    min2(min2(tetromino[p].pixelsInRotation[r][0].y, tetromino[p].pixelsInRotation[r][1].y), \
+	 min2(tetromino[p].pixelsInRotation[r][2].y, tetromino[p].pixelsInRotation[r][3].y)), \
+    max2(max2(tetromino[p].pixelsInRotation[r][0].y, tetromino[p].pixelsInRotation[r][1].y), \
+	 max2(tetromino[p].pixelsInRotation[r][2].y, tetromino[p].pixelsInRotation[r][3].y)) }
+#define PIECEMASKS(p) { PIECEMASK(p,0), PIECEMASK(p,1), PIECEMASK(p,2), PIECEMASK(p,3) }
+
+static constexpr pieceMask pieceMasks[NUMPIECES][4] PROGMEM = {
+  PIECEMASKS(0), PIECEMASKS(1), PIECEMASKS(2), PIECEMASKS(3),
+  PIECEMASKS(4), PIECEMASKS(5), PIECEMASKS(6)
+};
+
+// Sanity checks on the tables, so they don't have to be verified by eye
+
+static constexpr uint8_t popcount8(uint8_t v)
+{
+  return v ? (v & 1) + popcount8(v >> 1) : 0;
+}
+
+static constexpr bool maskIsValid(const pieceMask &m)
+{
+  // exactly four distinct pixels, all inside the box, including the anchor
+  return (popcount8(m.rows[0]) + popcount8(m.rows[1]) +
+	  popcount8(m.rows[2]) + popcount8(m.rows[3]) == 4) &&
+    (m.rows[PIECE_YBIAS] & (1 << PIECE_XBIAS)) &&
+    m.minX >= -PIECE_XBIAS && m.maxX < PIECE_BOXSIZE - PIECE_XBIAS &&
+    m.minY >= -PIECE_YBIAS && m.maxY < PIECE_BOXSIZE - PIECE_YBIAS;
+}
+
+static constexpr bool pieceIsValid(const pieceMask *m)
+{
+  return maskIsValid(m[0]) && maskIsValid(m[1]) &&
+    maskIsValid(m[2]) && maskIsValid(m[3]);
+}
+
+static_assert(pieceIsValid(pieceMasks[0]), "I piece table is malformed");
+static_assert(pieceIsValid(pieceMasks[1]), "O piece table is malformed");
+static_assert(pieceIsValid(pieceMasks[2]), "S piece table is malformed");
+static_assert(pieceIsValid(pieceMasks[3]), "Z piece table is malformed");
+static_assert(pieceIsValid(pieceMasks[4]), "L piece table is malformed");
+static_assert(pieceIsValid(pieceMasks[5]), "J piece table is malformed");
+static_assert(pieceIsValid(pieceMasks[6]), "T piece table is malformed");
+
+// Each kick set starts with a purely horizontal shove, and nothing
+// moves a piece more than two pixels in any direction
+static constexpr bool kickIsValid(const offset *k)
+{
+  return k[0].y == 0 &&
+    k[0].x >= -2 && k[0].x <= 2 && k[1].x >= -2 && k[1].x <= 2 &&
+    k[2].x >= -2 && k[2].x <= 2 && k[3].x >= -2 && k[3].x <= 2 &&
+    k[1].y >= -2 && k[1].y <= 2 && k[2].y >= -2 && k[2].y <= 2 &&
+    k[3].y >= -2 && k[3].y <= 2;
+}
+
+static constexpr bool kicksAreValid(const superRotationTemplate &t, uint8_t i)
+{
+  return i == 8 ? true : (kickIsValid(t.kickOffset[i]) && kicksAreValid(t, i+1));
+}
+
+static_assert(kicksAreValid(wallKickNotI, 0), "wallKickNotI is malformed");
+static_assert(kicksAreValid(wallKickI, 0), "wallKickI is malformed");
+
+
 Tetris::Tetris()
 {
   previousPieceFlags = 0;
@@ -121,11 +204,9 @@ Tetris::~Tetris()
 
 void Tetris::Init()
 {
-  for (int x=0; x<XSIZE; x++) {
-    for (int y=0; y<YSIZE; y++) {
-      board[y][x] = 0;
-    }
-  }
+  memset(rows, 0, sizeof(rows));
+  memset(pieceIndex, 0, sizeof(pieceIndex));
+  MarkAllDirty();
 
   currentScore = 0;
   numCompletedLinesThisStep = 0;
@@ -134,29 +215,132 @@ void Tetris::Init()
   StartDroppingNextPiece();
 }
 
+void Tetris::Seed(uint32_t s)
+{
+  rng.seed(s);
+}
+
+// FNV-1a over what's visible on the board, for checking replays
+uint32_t Tetris::BoardHash()
+{
+  uint32_t h = 2166136261UL;
+  for (int y=0; y<YSIZE; y++) {
+    for (int x=0; x<XSIZE; x++) {
+      h = (h ^ GetSquare(x, y)) * 16777619UL;
+    }
+  }
+  return h;
+}
+
 int Tetris::GetSquare(int x, int y)
 {
-  if (board[y][x]) {
-    return board[y][x];
+  if (IsFilled(x, y)) {
+    return pieceSymbols[PieceAt(x, y)];
   }
 
   return ' ';
 }
 
-void Tetris::SetPiece(uint8_t v)
+uint8_t Tetris::GetSquareIndex(int8_t x, int8_t y)
+{
+  if (IsFilled(x, y)) {
+    return SQUARE_PIECE(PieceAt(x, y));
+  }
+
+  return SQUARE_EMPTY;
+}
+
+bool Tetris::IsFilled(int8_t x, int8_t y)
+{
+  return rows[y] & (1 << x);
+}
+
+uint8_t Tetris::PieceAt(int8_t x, int8_t y)
+{
+  return (pieceIndex[y][x >> 1] >> ((x & 1) << 2)) & 0x0F;
+}
+
+uint32_t Tetris::DirtyRows()
+{
+  return dirtyRows;
+}
+
+uint8_t Tetris::DirtyCells(int8_t y)
+{
+  return dirtyCells[y];
+}
+
+void Tetris::ClearDirty()
+{
+  dirtyRows = 0;
+  memset(dirtyCells, 0, sizeof(dirtyCells));
+}
+
+void Tetris::MarkAllDirty()
+{
+  dirtyRows = (YSIZE == 32) ? 0xFFFFFFFFUL : ((1UL << YSIZE) - 1);
+  memset(dirtyCells, FULLROW, sizeof(dirtyCells));
+}
+
+void Tetris::MarkDirty(int8_t y, uint8_t cells)
 {
-  for (int8_t i=0; i<4; i++) {
-    int8_t y = curPieceY;
-    int8_t x = curPieceX;
+  if (cells) {
+    dirtyRows |= (1UL << y);
+    dirtyCells[y] |= cells;
+  }
+}
 
-    y += tetromino[curPieceIdx].pixelsInRotation[curPieceRotation][i].y;
-    x += tetromino[curPieceIdx].pixelsInRotation[curPieceRotation][i].x;
+void Tetris::SetCell(int8_t x, int8_t y, uint8_t idx)
+{
+  uint8_t shift = (x & 1) << 2;
+  MarkDirty(y, 1 << x);
+  rows[y] |= (1 << x);
+  pieceIndex[y][x >> 1] = (pieceIndex[y][x >> 1] & ~(0x0F << shift)) | (idx << shift);
+}
 
-    if (y >= 0 &&
-	y < YSIZE &&
-	x >= 0 &&
-	x < XSIZE) {
-      board[y][x] = v ? pieceSymbols[curPieceIdx] : 0;
+void Tetris::ClearCell(int8_t x, int8_t y)
+{
+  // The piece plane is only read where the occupancy bit is set, so
+  // there's no need to touch it here
+  MarkDirty(y, 1 << x);
+  rows[y] &= ~(1 << x);
+}
+
+void Tetris::GetPieceMask(uint8_t idx, uint8_t rotation, pieceMask *out)
+{
+  memcpy_P(out, &pieceMasks[idx][rotation], sizeof(pieceMask));
+}
+
+// Shift one row of a piece mask over to board column x (the anchor's
+// column), dropping anything that falls off either side of the board.
+uint8_t Tetris::PlaceRowMask(uint8_t rowMask, int8_t x)
+{
+  int8_t shift = x - PIECE_XBIAS;
+  if (shift >= 0) {
+    return ((uint16_t)rowMask << shift) & FULLROW;
+  }
+  return (rowMask >> -shift) & FULLROW;
+}
+
+void Tetris::SetPiece(uint8_t v)
+{
+  pieceMask m;
+  GetPieceMask(curPieceIdx, curPieceRotation, &m);
+
+  for (int8_t r=0; r<PIECE_BOXSIZE; r++) {
+    int8_t y = curPieceY + r - PIECE_YBIAS;
+    if (!m.rows[r] || y < 0 || y >= YSIZE)
+      continue;
+
+    uint8_t bits = PlaceRowMask(m.rows[r], curPieceX);
+    if (v) {
+      for (int8_t x=0; bits; x++, bits >>= 1) {
+	if (bits & 1)
+	  SetCell(x, y, curPieceIdx);
+      }
+    } else {
+      MarkDirty(y, rows[y] & bits);
+      rows[y] &= ~bits;
     }
   }
 }
@@ -206,23 +390,19 @@ void Tetris::CheckForFilledLines()
   numCompletedLinesThisStep = 0;
 
   for (int8_t y=YSIZE-1; y>=0; y--) {
-    uint8_t count = 0;
-    for (int8_t x=0; x<XSIZE; x++) {
-      if (board[y][x]) {
-	count++;
-      }
-    }
-    if (count == XSIZE) {
+    if (rows[y] == FULLROW) {
       // Row is full - delete it, move everything down, and repeat
       // this line's check
       lastCompletedLines[numCompletedLinesThisStep] = y - numCompletedLinesThisStep;
       numCompletedLinesThisStep++;
       currentScore++;
 
-      for (int8_t y2=y; y2>0; y2--) {
-	memcpy(&board[y2][0], &board[y2-1][0], sizeof(uint8_t) * XSIZE);
+      memmove(&rows[1], &rows[0], y);
+      rows[0] = 0;
+      memmove(&pieceIndex[1][0], &pieceIndex[0][0], y * sizeof(pieceIndex[0]));
+      for (int8_t y2=y; y2>=0; y2--) {
+	MarkDirty(y2, FULLROW);
       }
-      memset(&board[0][0], 0, sizeof(uint8_t) * XSIZE);
       y++;
     }
   }
@@ -238,14 +418,10 @@ bool Tetris::TrySuperRotation(uint8_t isCCW, uint8_t isIPiece)
   int8_t oldx = curPieceX;
   
   // Try the four offsets given our current rotation
+  const offset *kicks = (isIPiece ? wallKickI : wallKickNotI).kickOffset[curPieceRotation+4*isCCW];
   for (int i=0; i<4; i++) {
-    if (isIPiece) {
-      curPieceX = oldx + wallKickI.kickOffset[curPieceRotation+4*isCCW][i].x;
-      curPieceY = oldy + wallKickI.kickOffset[curPieceRotation+4*isCCW][i].y;
-    } else {
-      curPieceX = oldx + wallKickNotI.kickOffset[curPieceRotation+4*isCCW][i].x;
-      curPieceY = oldy + wallKickNotI.kickOffset[curPieceRotation+4*isCCW][i].y;
-    }
+    curPieceX = oldx + (int8_t)pgm_read_byte(&kicks[i].x);
+    curPieceY = oldy + (int8_t)pgm_read_byte(&kicks[i].y);
     if (!IsPieceBlocked()) {
       // It fits here! Do it.
       return true;
@@ -315,7 +491,6 @@ void Tetris::MoveRight()
 bool Tetris::Drop()
 {
   pieceChangedThisTurn = false;
-  int8_t origY = curPieceY;
 
   SetPiece(0);
   while (!IsPieceBlocked()) {
@@ -329,37 +504,26 @@ bool Tetris::Drop()
 
 bool Tetris::IsPieceBlocked()
 {
-  for (int8_t i=0; i<4; i++) {
-    int8_t y = curPieceY;
-    int8_t x = curPieceX;
-    if (board[y][x])
-      return true;
+  pieceMask m;
+  GetPieceMask(curPieceIdx, curPieceRotation, &m);
 
-    y += tetromino[curPieceIdx].pixelsInRotation[curPieceRotation][i].y;
-    x += tetromino[curPieceIdx].pixelsInRotation[curPieceRotation][i].x;
+  if (curPieceX + m.minX < 0 || curPieceX + m.maxX >= XSIZE) {
+    // horizontally offscreen is always a problem
+    return true;
+  }
+  if (curPieceY + m.maxY >= YSIZE) {
+    // Off the bottom of screen
+    return true;
+  }
 
-    if (x < 0 || x >= XSIZE) {
-      // horizontally offscreen is always a problem
+  for (int8_t r=0; r<PIECE_BOXSIZE; r++) {
+    int8_t y = curPieceY + r - PIECE_YBIAS;
+    // Rows above the top of the screen can't collide with anything
+    if (m.rows[r] && y >= 0 &&
+	(rows[y] & PlaceRowMask(m.rows[r], curPieceX))) {
+      // blocked by something onscreen
       return true;
     }
-
-    if (y >= 0) {
-      // It's onscreen; test for collisions or out of bounds
-      if (y >= YSIZE) {
-	// Off the bottom of screen
-	return true;
-      }
-
-      if (x < 0 || x >= XSIZE) {
-	// horizontally offscreen
-	return true;
-      }
-
-      if (board[y][x]) {
-	// blocked by something onscreen
-	return true;
-      }
-    }
   }
 
   return false;
@@ -380,7 +544,7 @@ uint8_t Tetris::pickNextPiece()
   }
 
   // pick which piece we want
-  uint8_t choice = RandomLessThan(nrp+1);
+  uint8_t choice = rng.lessThan(nrp);
 
   uint8_t ret = 0;
   // find that piece in the list of what's free
@@ -425,20 +589,63 @@ uint32_t Tetris::score()
   return currentScore;
 }
 
+uint8_t Tetris::currentPiece()
+{
+  return curPieceIdx;
+}
+
+uint8_t Tetris::nextPiece()
+{
+  return nextPieceIdx;
+}
+
+int8_t Tetris::currentX()
+{
+  return curPieceX;
+}
+
+int8_t Tetris::currentY()
+{
+  return curPieceY;
+}
+
+int8_t Tetris::currentRotation()
+{
+  return curPieceRotation;
+}
+
+// Copy the board's occupancy rows, minus the piece that's still falling
+void Tetris::GetSettledRows(uint8_t *out)
+{
+  memcpy(out, rows, sizeof(rows));
+
+  pieceMask m;
+  GetPieceMask(curPieceIdx, curPieceRotation, &m);
+  for (int8_t r=0; r<PIECE_BOXSIZE; r++) {
+    int8_t y = curPieceY + r - PIECE_YBIAS;
+    if (m.rows[r] && y >= 0 && y < YSIZE) {
+      out[y] &= ~PlaceRowMask(m.rows[r], curPieceX);
+    }
+  }
+}
+
 void Tetris::SetupTest()
 {
+  // Fill with O pieces ('*')
   for (int y=21; y<32; y++) {
     for (int x=0; x<5; x++) {
-      board[y][x] = '*';
+      SetCell(x, y, 1);
     }
     if (y > 22)
-      board[y][7] = '*';
+      SetCell(7, y, 1);
   }
-  board[23][6] = '*';
-  board[25][6] = board[26][6] = '*';
-  board[28][6] = board[29][6] = '*';
-  board[31][6] = '*';
-
-  board[21][5] = '*';
-  board[20][5] = '*';
+  SetCell(6, 23, 1);
+  SetCell(6, 25, 1);
+  SetCell(6, 26, 1);
+  SetCell(6, 28, 1);
+  SetCell(6, 29, 1);
+  SetCell(6, 31, 1);
+
+  SetCell(5, 21, 1);
+  SetCell(5, 20, 1);
 }
@@ -2,13 +2,25 @@
 #define __TETRIS_H
 
 #include <stdint.h> // for uint8_t
+#include "GameRandom.h"
 
 #define YSIZE 32
 #define XSIZE 8
 
+// Each board row is kept as a one-byte occupancy mask (bit x set when
+// column x is filled), so the board can't be any wider than that.
+#define FULLROW ((uint8_t)((1 << XSIZE) - 1))
+
 // piece types
 #define NUMPIECES 7
 
+// Square indices, as returned by GetSquareIndex(). These double as
+// palette indices (see Palette.h).
+#define SQUARE_EMPTY 0
+#define SQUARE_PIECE(idx) ((idx) + 1)
+#define SQUARE_SNAKE (NUMPIECES + 1)
+#define SQUARE_FOOD (NUMPIECES + 2)
+
 typedef struct _offset {
   int8_t x;
   int8_t y;
@@ -28,6 +40,25 @@ typedef struct _tetTemplate {
 typedef struct _superRotationTemplate {
   offset kickOffset[8 /* rotations */][4 /* offsets */];
 } superRotationTemplate;
+
+// The canonical piece shapes. The row masks below are generated from
+// these at compile time. They live in flash; read them with
+// pgm_read_byte().
+extern const tetTemplate tetromino[NUMPIECES];
+
+// Every piece in every rotation fits in a 4x4 box whose upper-left is
+// (-1,-1) relative to the anchor pixel. Each row of the box is a bitmask
+// (bit 0 is dx == -1), so a piece can be placed or tested against the
+// board's row masks with a shift and an AND per row.
+#define PIECE_BOXSIZE 4
+#define PIECE_XBIAS 1
+#define PIECE_YBIAS 1
+
+typedef struct _pieceMask {
+  uint8_t rows[PIECE_BOXSIZE];
+  int8_t minX, maxX; // bounding box, relative to the anchor
+  int8_t minY, maxY;
+} pieceMask;
   
 class Tetris {
  public:
@@ -35,12 +66,22 @@ class Tetris {
   ~Tetris();
 
   void Init();
+  void Seed(uint32_t s); // call before Init() to replay a game
+  uint32_t BoardHash();
 
   void SetupTest();
 
   int GetSquare(int x, int y);
+  uint8_t GetSquareIndex(int8_t x, int8_t y);
   bool Step(); // return true while game still going
 
+  // Which cells have changed since the last ClearDirty(), so the
+  // renderer only has to redraw those
+  uint32_t DirtyRows(); // bit y set if anything in row y changed
+  uint8_t DirtyCells(int8_t y); // bit x set if (x,y) changed
+  void ClearDirty();
+  void MarkAllDirty();
+
   void RotateLeft();
   void RotateRight();
   void MoveLeft();
@@ -55,7 +96,20 @@ class Tetris {
 
   uint32_t score();
 
+  // State of the falling piece, for the autopilot
+  uint8_t currentPiece();
+  uint8_t nextPiece();
+  int8_t currentX();
+  int8_t currentY();
+  int8_t currentRotation();
+  void GetSettledRows(uint8_t *out);
+
+  static void GetPieceMask(uint8_t idx, uint8_t rotation, pieceMask *out);
+  static uint8_t PlaceRowMask(uint8_t rowMask, int8_t x);
+
  private:
+  friend class TetrisFixture; // the host benchmarks set up boards directly
+
   bool StartDroppingNextPiece();
 
   void SetPiece(uint8_t v);
@@ -65,8 +119,21 @@ class Tetris {
 
   void CheckForFilledLines();
 
+  bool IsFilled(int8_t x, int8_t y);
+  uint8_t PieceAt(int8_t x, int8_t y);
+  void SetCell(int8_t x, int8_t y, uint8_t pieceIdx);
+  void ClearCell(int8_t x, int8_t y);
+  void MarkDirty(int8_t y, uint8_t cells);
+
  private:
-  uint8_t board[YSIZE][XSIZE];
+  // The board is two planes: an occupancy bitboard with one byte per
+  // row, and a compact piece-index plane (one nibble per cell) that's
+  // only consulted when drawing.
+  uint8_t rows[YSIZE];
+  uint8_t pieceIndex[YSIZE][XSIZE/2];
+
+  uint32_t dirtyRows;
+  uint8_t dirtyCells[YSIZE];
   uint8_t nextPieceIdx;
   uint8_t curPieceIdx;
   int8_t curPieceY;
@@ -79,6 +146,8 @@ class Tetris {
   bool pieceChangedThisTurn;
 
   uint32_t currentScore;
+
+  GameRandom rng;
 };
 
 #endif